@@ -0,0 +1,358 @@
+// Load generator for the lottery server: opens many concurrent participant sessions against a server started with
+// --external and records per-phase latencies in HDR-style histograms.
+//
+//   ./main --external --participants 10000 --quiet &
+//   ./loadgen --sessions 10000 --rate 20000
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+
+#define PORT 12345                         // Port number of the lottery server
+#define SOCKET_PATH "/tmp/loteria.sock"    // Address of the AF_UNIX transport
+#define MAX_EVENTS 256                     // Events handled per epoll_wait call
+#define HIST_SUB_BITS 7                    // 128 linear sub-buckets per power of two: under 1% relative error
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (64 - HIST_SUB_BITS + 1)
+
+typedef enum { CONNECTING, SENDING, WAITING_RESULT, ACKING, DONE, FAILED } state_t;
+
+typedef struct {                           // One participant session
+    int fd;
+    state_t state;
+    int32_t id;                            // Stands in for the PID in the lottery protocol
+    int32_t result;                        // ID drawn by the server
+    size_t done;                           // Bytes of the current 4-byte message already transferred
+    int64_t connect_ns;                    // connect() called
+    int64_t established_ns;                // Connection established
+    int64_t registered_ns;                 // ID fully written to the socket buffer, not yet read by the server
+    int64_t result_ns;                     // Result fully read
+} session_t;
+
+typedef struct {                           // Log-linear histogram of nanosecond values, in the style of HdrHistogram
+    uint64_t counts[HIST_BUCKETS * HIST_SUB];
+    uint64_t total;
+    int64_t max;
+} histogram_t;
+
+typedef struct {                           // Command line
+    int sessions;
+    double rate;                           // Sessions started per second (0: all at once)
+    int unix_socket;
+    const char *host;
+    int port;
+    int32_t first_id;
+} options_t;
+
+void error(const char *msg) {              // Error handling function
+    perror(msg);                           // Print error message
+    exit(1);                               // Exit with error code
+}
+
+int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int hist_index(int64_t value) {
+    if (value < HIST_SUB)
+        return value < 0 ? 0 : (int) value;
+    int exponent = 63 - __builtin_clzll((uint64_t) value);
+    int bucket = exponent - HIST_SUB_BITS + 1;
+    return bucket * HIST_SUB + (int) ((value >> (bucket - 1)) - HIST_SUB);
+}
+
+// Highest value that falls in a histogram index
+int64_t hist_value(int index) {
+    int bucket = index / HIST_SUB;
+    int64_t sub = index % HIST_SUB;
+    if (bucket == 0)
+        return sub;
+    return ((sub + HIST_SUB + 1) << (bucket - 1)) - 1;
+}
+
+void hist_record(histogram_t *hist, int64_t value) {
+    hist->counts[hist_index(value)]++;
+    hist->total++;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+int64_t hist_percentile(const histogram_t *hist, double percentile) {
+    uint64_t target = (uint64_t) (percentile / 100.0 * hist->total + 0.999999);
+    uint64_t seen = 0;
+    if (target == 0)
+        target = 1;
+    for (int i = 0; i < HIST_BUCKETS * HIST_SUB; i++) {
+        seen += hist->counts[i];
+        if (seen >= target)
+            return hist_value(i) < hist->max ? hist_value(i) : hist->max;
+    }
+    return hist->max;
+}
+
+void hist_print(const char *phase, const histogram_t *hist) {
+    if (hist->total == 0) {
+        printf("%-9s %8d %10s %10s %10s %10s\n", phase, 0, "-", "-", "-", "-");
+        return;
+    }
+    printf("%-9s %8llu %10.1f %10.1f %10.1f %10.1f\n", phase, (unsigned long long) hist->total,
+           hist_percentile(hist, 50) / 1e3, hist_percentile(hist, 99) / 1e3, hist_percentile(hist, 99.9) / 1e3,
+           hist->max / 1e3);
+}
+
+// Each session is a descriptor, so allow as many as the hard limit permits
+void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void watch(int epfd, session_t *session, uint32_t events, int op) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = session;
+    if (epoll_ctl(epfd, op, session->fd, &ev) < 0)
+        error("Error registering session"); // Handle epoll_ctl error
+}
+
+void finish_session(int epfd, session_t *session, state_t state, int *active) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    session->state = state;
+    (*active)--;
+}
+
+// Starts a non-blocking connect; returns 0 if the server's backlog is full and the session should retry later
+int start_session(int epfd, session_t *session, const options_t *options) {
+    session->fd = socket(options->unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (session->fd < 0)
+        error("Error opening session socket"); // Handle socket opening error
+    session->connect_ns = now_ns();
+
+    int result;
+    if (options->unix_socket) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+        result = connect(session->fd, (struct sockaddr *) &addr, sizeof(addr));
+    } else {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr(options->host);
+        addr.sin_port = htons(options->port);
+        result = connect(session->fd, (struct sockaddr *) &addr, sizeof(addr));
+    }
+    if (result < 0 && errno == EAGAIN) {   // AF_UNIX: the listener's backlog is full
+        close(session->fd);
+        return 0;
+    }
+    if (result < 0 && errno != EINPROGRESS)
+        error("Error connecting session"); // Handle connection error
+
+    session->state = CONNECTING;
+    watch(epfd, session, EPOLLOUT, EPOLL_CTL_ADD);
+    return 1;
+}
+
+// Moves 4 bytes of a session; returns 1 when done, 0 to wait, -1 if the server is gone
+int transfer(session_t *session, int32_t *value, int writing) {
+    while (session->done < sizeof(int32_t)) {
+        char *buf = (char *) value + session->done;
+        ssize_t n = writing ? write(session->fd, buf, sizeof(int32_t) - session->done)
+                            : read(session->fd, buf, sizeof(int32_t) - session->done);
+        if (n > 0)
+            session->done += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        else
+            return -1;
+    }
+    session->done = 0;
+    return 1;
+}
+
+// Advances a session after a readiness event, through connect, register, result and ack
+void advance(int epfd, session_t *session, int *active) {
+    int status;
+    switch (session->state) {
+    case CONNECTING: {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+            finish_session(epfd, session, FAILED, active);
+            return;
+        }
+        session->established_ns = now_ns();
+        session->state = SENDING;
+    }   // fall through
+    case SENDING:
+        status = transfer(session, &session->id, 1);
+        if (status < 0)
+            finish_session(epfd, session, FAILED, active);
+        if (status <= 0)
+            return;
+        session->registered_ns = now_ns();
+        session->state = WAITING_RESULT;
+        watch(epfd, session, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+        return;
+    case WAITING_RESULT:
+        status = transfer(session, &session->result, 0);
+        if (status < 0)
+            finish_session(epfd, session, FAILED, active);
+        if (status <= 0)
+            return;
+        session->result_ns = now_ns();
+        session->state = ACKING;
+        watch(epfd, session, EPOLLOUT, EPOLL_CTL_MOD);
+        // fall through
+    case ACKING:
+        status = transfer(session, &session->id, 1); // Ack: the result arrived
+        if (status != 0)
+            finish_session(epfd, session, status > 0 ? DONE : FAILED, active);
+        return;
+    default:
+        return;
+    }
+}
+
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--sessions <n>] [--rate <per second>] [--unix] [--host <ip>] [--port <n>] [--first-id <n>]\n",
+            program);
+    fprintf(stderr, "  --sessions <n>      participant sessions to open (default: 1000); match the server's --participants\n");
+    fprintf(stderr, "  --rate <n>          sessions started per second (default: 0, all at once)\n");
+    fprintf(stderr, "  --unix              connect to %s instead of TCP\n", SOCKET_PATH);
+    fprintf(stderr, "  --first-id <n>      ID of the first session (default: 1), to run several generators at once\n");
+    fprintf(stderr, "Registration has no per-session latency: the server does not acknowledge it, so the client only\n");
+    fprintf(stderr, "sees its write() complete. registrations/s counts IDs handed to the kernel, not ones the server read.\n");
+}
+
+int main(int argc, char *argv[]) {
+    options_t options = { 1000, 0, 0, "127.0.0.1", PORT, 1 };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc)
+            options.sessions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+            options.rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--unix") == 0)
+            options.unix_socket = 1;
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+            options.host = argv[++i];
+        else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+            options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--first-id") == 0 && i + 1 < argc)
+            options.first_id = atoi(argv[++i]);
+        else
+            options.sessions = 0;          // Reported below
+    }
+    if (options.sessions <= 0 || options.rate < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    raise_fd_limit();
+
+    session_t *sessions = calloc(options.sessions, sizeof(session_t));
+    if (sessions == NULL)
+        error("Error allocating sessions"); // Handle allocation error
+    int epfd = epoll_create1(0);
+    if (epfd < 0)
+        error("Error creating epoll instance"); // Handle epoll_create1 error
+
+    // Sessions start on schedule (rate) and progress concurrently in one event loop
+    struct epoll_event events[MAX_EVENTS];
+    int started = 0;
+    int active = 0;
+    int64_t start = now_ns();
+    while (started < options.sessions || active > 0) {
+        int64_t now = now_ns();
+        while (started < options.sessions &&
+               (options.rate == 0 || now >= start + (int64_t) (started * 1e9 / options.rate))) {
+            session_t *session = &sessions[started];
+            session->id = options.first_id + started;
+            if (!start_session(epfd, session, &options))
+                break;                     // Retry after the server drains its backlog
+            started++;
+            active++;
+        }
+
+        int timeout = -1;                  // Until the next scheduled start, if any
+        if (started < options.sessions && options.rate == 0) {
+            timeout = 1;                   // The backlog was full: retry shortly
+        } else if (started < options.sessions) {
+            int64_t next = start + (int64_t) (started * 1e9 / options.rate);
+            timeout = next > now ? (int) ((next - now + 999999) / 1000000) : 0;
+        }
+        int n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            error("Error waiting for events"); // Handle epoll_wait error
+        }
+        for (int i = 0; i < n; i++)
+            advance(epfd, events[i].data.ptr, &active);
+    }
+    close(epfd);
+
+    // Result latency runs from the last registration sent: only then can the server draw
+    histogram_t *connect_hist = calloc(1, sizeof(histogram_t));
+    histogram_t *result_hist = calloc(1, sizeof(histogram_t));
+    if (connect_hist == NULL || result_hist == NULL)
+        error("Error allocating histograms"); // Handle allocation error
+    int64_t last_registered = 0, last_result = 0;
+    int failed = 0, registered = 0, won = 0;
+    for (int i = 0; i < options.sessions; i++) {
+        session_t *session = &sessions[i];
+        if (session->established_ns)
+            hist_record(connect_hist, session->established_ns - session->connect_ns);
+        if (session->registered_ns) {
+            registered++;
+            if (session->registered_ns > last_registered)
+                last_registered = session->registered_ns;
+        }
+        if (session->result_ns > last_result)
+            last_result = session->result_ns;
+        if (session->state == FAILED)
+            failed++;
+        if (session->state == DONE && session->result == session->id)
+            won = session->id;
+    }
+    for (int i = 0; i < options.sessions; i++)
+        if (sessions[i].result_ns)
+            hist_record(result_hist, sessions[i].result_ns - last_registered);
+
+    if (options.rate == 0)
+        printf("%d sessions, all at once, %s\n", options.sessions, options.unix_socket ? "unix" : "tcp");
+    else
+        printf("%d sessions, %.0f per second, %s\n", options.sessions, options.rate, options.unix_socket ? "unix" : "tcp");
+    printf("%-9s %8s %10s %10s %10s %10s\n", "phase", "count", "p50 us", "p99 us", "p99.9 us", "max us");
+    hist_print("connect", connect_hist);
+    hist_print("result", result_hist);
+    printf("registrations/s: %.0f  results/s: %.0f  failed: %d\n",
+           last_registered > start ? registered / ((last_registered - start) / 1e9) : 0.0,
+           last_result > last_registered ? result_hist->total / ((last_result - last_registered) / 1e9) : 0.0, failed);
+    if (won)
+        printf("Session %d was drawn\n", won);
+
+    free(connect_hist);
+    free(result_hist);
+    free(sessions);
+    return failed ? 1 : 0;
+}
@@ -9,12 +9,75 @@
 #include <time.h>
 #include <errno.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/un.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #define PORT 12345                         // Port number
-#define BACKLOG 10                         // Maximum number of pending connections
-#define NUM_CHILDREN 10                    // Number of child processes
+#define BACKLOG SOMAXCONN                  // Maximum number of pending connections
+#define NUM_CHILDREN 10                    // Default number of child processes
+#define MAX_EVENTS 64                      // Events handled per epoll_wait call
+#define SOCKET_PATH "/tmp/loteria.sock"    // Address of the AF_UNIX transport
+
+typedef enum { TRANSPORT_TCP, TRANSPORT_UNIX, TRANSPORT_SHM } transport_t;
+const char *transport_names[] = { "tcp", "unix", "shm" };
+
+typedef struct {                           // Command line
+    transport_t transport;
+    int persistent;                        // One connection per participant (socket transports)
+    int participants;
+    int workers;                           // Acceptor processes (socket transports)
+    int external;                          // Participants are external clients (e.g. loadgen), not forked children
+} options_t;
+
+typedef struct {                           // One accepted connection being served by the event loop
+    int fd;
+    size_t done;                           // Bytes of the PID already read or written
+    pid_t pid;                             // PID received (registration) or to be sent (result)
+    int acking;                            // Result sent, waiting for the participant's ack
+    int watched;                           // Registered in the epoll set
+} connection_t;
+
+typedef struct {                           // Registrations shared by the parent and the acceptor workers
+    int participants;                      // Child processes expected to register
+    int registered;                        // PIDs stored in pids
+    int finished;                          // Connections done with the current phase, completed or lost
+    int accepted;                          // Registration connections accepted, by every worker together
+    int acknowledged;                      // Children that acknowledged the result
+    pid_t drawn_pid;
+    int gate;                              // Futex: 0 until every participant exists
+    int published;                         // Futex: 0 until drawn_pid is set
+    int64_t start_ns;                      // When the gate opened
+    int64_t published_ns;                  // When the draw was published
+    int64_t *registered_ns;                // When each slot of pids was filled
+    int64_t *delivered_ns;                 // When each participant (by fork index) got the result
+    pid_t pids[];                          // Registered PIDs, in arrival order (the registration ring)
+} registry_t;
+
+typedef struct {                           // One acceptor worker process
+    int id;
+    int epfd;
+    int sockfd;                            // This worker's listening socket
+    registry_t *registry;
+    connection_t **kept;                   // Open registration connections (persistent mode)
+    int kept_count;
+    int kept_capacity;
+} worker_t;
 
 volatile sig_atomic_t proceed = 0;
+int registration_done;                     // Latch: every participant registered or was lost
+int draw_ready;                            // Latch: the drawn PID is in the registry
+int result_done;                           // Latch: every registered participant acknowledged or was lost
+int verbose = 1;                           // Per-participant messages (off while benchmarking)
 
 void error(const char *msg) {              // Error handling function
     perror(msg);                           // Print error message
@@ -25,158 +88,715 @@ void signal_handler(int signum) {
     proceed = 1;
 }
 
-int main() {
-    int sockfd, newsockfd;
-    struct sockaddr_in serv_addr, cli_addr;
-    socklen_t clilen;
-    int pids_received[NUM_CHILDREN];
+int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Futexes on MAP_SHARED memory, so not FUTEX_PRIVATE: they work across the forked processes
+void futex_wait_while(int *word, int value) {
+    while (__atomic_load_n(word, __ATOMIC_SEQ_CST) == value)
+        syscall(SYS_futex, word, FUTEX_WAIT, value, NULL, NULL, 0);
+}
+
+void futex_wake_all(int *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+transport_t parse_transport(const char *name) {
+    for (int t = 0; t < 3; t++)
+        if (strcmp(name, transport_names[t]) == 0)
+            return t;
+    return -1;
+}
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        error("Error setting non-blocking mode"); // Handle fcntl error
+}
+
+// Accepts every pending connection and registers it in the epoll set. With a quota, accepts stop once every
+// worker together has accepted quota connections; a slot is reserved before each accept and returned on failure.
+void accept_pending(int epfd, int sockfd, uint32_t events, pid_t pid, int *accepted, int quota) {
+    for (;;) {
+        if (accepted != NULL && __atomic_fetch_add(accepted, 1, __ATOMIC_SEQ_CST) >= quota) {
+            __atomic_fetch_sub(accepted, 1, __ATOMIC_SEQ_CST);
+            break;                         // The rest belongs to the next phase
+        }
+        int fd = accept(sockfd, NULL, NULL);
+        if (fd < 0 && accepted != NULL)
+            __atomic_fetch_sub(accepted, 1, __ATOMIC_SEQ_CST);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;                     // Backlog drained
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            error("Error accepting connection"); // Handle connection acceptance error
+        }
+        set_nonblocking(fd);
+
+        connection_t *conn = malloc(sizeof(connection_t));
+        if (conn == NULL)
+            error("Error allocating connection"); // Handle allocation error
+        conn->fd = fd;
+        conn->done = 0;
+        conn->pid = pid;
+        conn->acking = 0;
+        conn->watched = 1;
+
+        struct epoll_event ev;
+        ev.events = events;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            error("Error registering connection"); // Handle epoll_ctl error
+    }
+}
+
+void close_connection(int epfd, connection_t *conn) {
+    if (conn->watched)
+        epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    free(conn);
+}
+
+// Reads or writes the rest of a connection's PID; returns 1 when done, 0 to wait, -1 if the peer is gone
+int transfer_pid(connection_t *conn, int writing) {
+    while (conn->done < sizeof(pid_t)) {
+        char *buf = (char *) &conn->pid + conn->done;
+        ssize_t n = writing ? write(conn->fd, buf, sizeof(pid_t) - conn->done)
+                            : read(conn->fd, buf, sizeof(pid_t) - conn->done);
+        if (n > 0)
+            conn->done += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;                      // Wait for the next readiness event
+        else
+            return -1;                     // Closed or failed before the whole PID went through
+    }
+    return 1;
+}
+
+// Result phase of one connection: writes the drawn PID, then reads the participant's ack (its own PID echoed
+// back once it holds the result). Returns 1 when acknowledged, 0 to wait, -1 if the peer is gone.
+int serve_result(int epfd, connection_t *conn) {
+    if (!conn->acking) {
+        int status = transfer_pid(conn, 1);
+        if (status <= 0)
+            return status;
+        conn->acking = 1;
+        conn->done = 0;
+        status = transfer_pid(conn, 0);
+        if (status != 0)
+            return status;
+
+        struct epoll_event ev;             // Wait for the ack
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epfd, conn->watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, conn->fd, &ev) < 0)
+            error("Error registering connection"); // Handle epoll_ctl error
+        conn->watched = 1;
+        return 0;
+    }
+    return transfer_pid(conn, 0);
+}
+
+// Latches are eventfds that are written once and never read, so they stay readable for every process waiting on them
+void fire_latch(int latch) {
+    uint64_t one = 1;
+    if (write(latch, &one, sizeof(one)) != sizeof(one))
+        error("Error firing latch");       // Handle eventfd write error
+}
+
+void wait_latch(int latch) {
+    struct pollfd pfd = { latch, POLLIN, 0 };
+    while (poll(&pfd, 1, -1) < 0)
+        if (errno != EINTR)
+            error("Error waiting for latch"); // Handle poll error
+}
+
+// Counts one connection as done with the current phase; the one that completes the phase fires its latch
+void finish_one(registry_t *registry, int expected, int latch) {
+    if (__atomic_add_fetch(&registry->finished, 1, __ATOMIC_SEQ_CST) == expected)
+        fire_latch(latch);
+}
+
+void keep_connection(worker_t *worker, connection_t *conn) {
+    if (worker->kept_count == worker->kept_capacity) {
+        worker->kept_capacity = worker->kept_capacity ? 2 * worker->kept_capacity : 64;
+        worker->kept = realloc(worker->kept, worker->kept_capacity * sizeof(connection_t *));
+        if (worker->kept == NULL)
+            error("Error allocating connections"); // Handle allocation error
+    }
+    worker->kept[worker->kept_count++] = conn;
+}
+
+// A registration was read: stores the PID in the shared registry and keeps (persistent mode) or closes the connection
+void register_pid(worker_t *worker, connection_t *conn, int persistent) {
+    registry_t *registry = worker->registry;
+    int slot = __atomic_fetch_add(&registry->registered, 1, __ATOMIC_SEQ_CST);
+    if (slot < registry->participants) {
+        registry->pids[slot] = conn->pid;
+        registry->registered_ns[slot] = now_ns();
+        if (verbose)
+            printf("Worker %d received PID %d\n", worker->id, conn->pid);
+    } else {
+        __atomic_fetch_sub(&registry->registered, 1, __ATOMIC_SEQ_CST); // Not a participant of this draw
+        fprintf(stderr, "Unexpected registration from PID %d\n", conn->pid);
+        close_connection(worker->epfd, conn);
+        return;
+    }
+
+    if (persistent) {                      // The result goes back on this connection
+        epoll_ctl(worker->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+        conn->watched = 0;
+        keep_connection(worker, conn);
+    } else {
+        close_connection(worker->epfd, conn);
+    }
+    finish_one(registry, registry->participants, registration_done);
+}
+
+// A result connection is over: acknowledged (status > 0) or lost (status < 0)
+void finish_result(worker_t *worker, connection_t *conn, int status) {
+    registry_t *registry = worker->registry;
+    if (status > 0)
+        __atomic_fetch_add(&registry->acknowledged, 1, __ATOMIC_SEQ_CST);
+    else
+        fprintf(stderr, "Connection closed before the PID was acknowledged\n");
+    close_connection(worker->epfd, conn);
+    finish_one(registry, registry->registered, result_done);
+}
+
+// Serves this worker's share of a phase until the phase latch fires: reads a PID from every connection
+// (writing = 0) or writes the drawn PID to every connection and waits for its ack (writing = 1)
+void serve_phase(worker_t *worker, int writing, int persistent, int latch) {
+    static char latch_marker;              // epoll data of the latch
+    struct epoll_event events[MAX_EVENTS];
+    uint32_t conn_events = writing ? EPOLLOUT : EPOLLIN | EPOLLRDHUP;
+    pid_t pid = writing ? worker->registry->drawn_pid : 0;
+
+    struct epoll_event latch_ev;
+    latch_ev.events = EPOLLIN;
+    latch_ev.data.ptr = &latch_marker;
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, latch, &latch_ev) < 0)
+        error("Error registering latch");  // Handle epoll_ctl error
+
+    for (int done = 0; !done;) {
+        int n = epoll_wait(worker->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            error("Error waiting for events"); // Handle epoll_wait error
+        }
+        for (int i = 0; i < n && !done; i++)
+            done = events[i].data.ptr == &latch_marker; // Every worker together finished the phase: the rest of
+                                                        // the batch, if any, belongs to the next phase
+        for (int i = 0; i < n && !done; i++) {
+            if (events[i].data.ptr == NULL) { // Listening socket
+                // Each participant registers once and only reconnects for the result after every registration
+                // finished, so the first participants connections are exactly the registrations
+                accept_pending(worker->epfd, worker->sockfd, conn_events, pid,
+                               writing ? NULL : &worker->registry->accepted, worker->registry->participants);
+                continue;
+            }
+            connection_t *conn = events[i].data.ptr;
+            int status = writing ? serve_result(worker->epfd, conn) : transfer_pid(conn, 0);
+            if (status == 0)
+                continue;
+            if (writing) {
+                finish_result(worker, conn, status);
+            } else if (status > 0) {
+                register_pid(worker, conn, persistent);
+            } else {
+                fprintf(stderr, "Connection closed before the PID was received\n");
+                close_connection(worker->epfd, conn);
+                finish_one(worker->registry, worker->registry->participants, registration_done);
+            }
+        }
+    }
+    epoll_ctl(worker->epfd, EPOLL_CTL_DEL, latch, NULL);
+}
+
+// Persistent mode: writes the drawn PID to every connection kept by this worker in one pass, then waits on epoll
+// for the acks (and for the few sockets whose buffer was full)
+void broadcast_pid(worker_t *worker) {
+    struct epoll_event events[MAX_EVENTS];
+    int waiting = 0;
+
+    for (int i = 0; i < worker->kept_count; i++) {
+        connection_t *conn = worker->kept[i];
+        conn->pid = worker->registry->drawn_pid;
+        conn->done = 0;
+        int status = serve_result(worker->epfd, conn);
+        if (status == 0) {
+            if (!conn->watched) {          // Send buffer full: wait until it drains
+                struct epoll_event ev;
+                ev.events = EPOLLOUT;
+                ev.data.ptr = conn;
+                if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, conn->fd, &ev) < 0)
+                    error("Error registering connection"); // Handle epoll_ctl error
+                conn->watched = 1;
+            }
+            waiting++;
+            continue;
+        }
+        finish_result(worker, conn, status);
+    }
+
+    while (waiting > 0) {
+        int n = epoll_wait(worker->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            error("Error waiting for events"); // Handle epoll_wait error
+        }
+        for (int i = 0; i < n; i++) {
+            connection_t *conn = events[i].data.ptr;
+            if (conn == NULL)              // Nobody else is expected on the listening socket
+                continue;
+            int status = serve_result(worker->epfd, conn);
+            if (status == 0)
+                continue;
+            finish_result(worker, conn, status);
+            waiting--;
+        }
+    }
+}
+
+// Acceptor worker process: serves the connections the kernel hands to its listening socket in both phases
+void run_worker(worker_t *worker, int persistent) {
+    setvbuf(stdout, NULL, _IOLBF, 0);       // Whole lines, so workers sharing stdout don't interleave mid-line
+    worker->epfd = epoll_create1(0);
+    if (worker->epfd < 0)
+        error("Error creating epoll instance"); // Handle epoll_create1 error
+    struct epoll_event listen_ev;
+    listen_ev.events = EPOLLIN;            // A shared AF_UNIX socket wakes every worker; losers get EAGAIN
+    listen_ev.data.ptr = NULL;             // NULL marks the listening socket
+    if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, worker->sockfd, &listen_ev) < 0)
+        error("Error registering listening socket"); // Handle epoll_ctl error
+
+    serve_phase(worker, 0, persistent, registration_done);
+    wait_latch(draw_ready);
+    if (persistent)
+        broadcast_pid(worker);
+    else
+        serve_phase(worker, 1, persistent, result_done);
+
+    close(worker->epfd);
+    close(worker->sockfd);
+    exit(0);
+}
+
+// Listening socket of the socket transports. For TCP every worker binds its own socket to the same port and the
+// kernel spreads connections among them (SO_REUSEPORT); AF_UNIX has no such option, so its workers share one socket.
+int open_listener(transport_t transport) {
     int optval = 1;
 
     // Creating the socket
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = socket(transport == TRANSPORT_UNIX ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0)
         error("Error opening socket");     // Handle socket opening error
 
-    // Setting socket options to reuse address
-    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0)
-        error("Error setting socket options"); // Handle setsockopt error
-
-    // Configuring server address
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_addr.s_addr = INADDR_ANY;
-    serv_addr.sin_port = htons(PORT);
-
-    // Binding the socket to an address
-    if (bind(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
-        error("Error binding socket");     // Handle binding error
+    if (transport == TRANSPORT_UNIX) {
+        // Configuring server address
+        struct sockaddr_un serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sun_family = AF_UNIX;
+        strncpy(serv_addr.sun_path, SOCKET_PATH, sizeof(serv_addr.sun_path) - 1);
+        unlink(SOCKET_PATH);               // Left behind by an earlier run
+
+        // Binding the socket to an address
+        if (bind(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
+            error("Error binding socket"); // Handle binding error
+    } else {
+        // Setting socket options to reuse address and share the port with the other workers
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0 ||
+            setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0)
+            error("Error setting socket options"); // Handle setsockopt error
+
+        // Configuring server address
+        struct sockaddr_in serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_addr.s_addr = INADDR_ANY;
+        serv_addr.sin_port = htons(PORT);
+
+        // Binding the socket to an address
+        if (bind(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
+            error("Error binding socket"); // Handle binding error
+    }
 
     // Preparing to listen for connections
     if (listen(sockfd, BACKLOG) < 0)
         error("Error listening");          // Handle listening error
+    set_nonblocking(sockfd);
+    return sockfd;
+}
 
-    printf("Parent process is listening for connections on port %d\n", PORT);
+// Child side of the socket transports: a connected socket to the server
+int connect_server(transport_t transport) {
+    int sockfd_child;
+
+    // Creating the child's socket
+    sockfd_child = socket(transport == TRANSPORT_UNIX ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (sockfd_child < 0)
+        error("Error opening child socket"); // Handle child socket error
+
+    if (transport == TRANSPORT_UNIX) {
+        // Configuring the server address for the child
+        struct sockaddr_un serv_addr_child;
+        memset(&serv_addr_child, 0, sizeof(serv_addr_child));
+        serv_addr_child.sun_family = AF_UNIX;
+        strncpy(serv_addr_child.sun_path, SOCKET_PATH, sizeof(serv_addr_child.sun_path) - 1);
+
+        // Connecting to the server
+        if (connect(sockfd_child, (struct sockaddr *) &serv_addr_child, sizeof(serv_addr_child)) < 0)
+            error("Error connecting child socket"); // Handle child connection error
+    } else {
+        // Configuring the server address for the child
+        struct sockaddr_in serv_addr_child;
+        memset(&serv_addr_child, 0, sizeof(serv_addr_child));
+        serv_addr_child.sin_family = AF_INET;
+        serv_addr_child.sin_addr.s_addr = inet_addr("127.0.0.1");
+        serv_addr_child.sin_port = htons(PORT);
+
+        // Connecting to the server
+        if (connect(sockfd_child, (struct sockaddr *) &serv_addr_child, sizeof(serv_addr_child)) < 0)
+            error("Error connecting child socket"); // Handle child connection error
+    }
+    return sockfd_child;
+}
 
-    // Creating child processes
-    for (int i = 0; i < NUM_CHILDREN; i++) {
+// Shared-memory transport: the child claims a slot of the registry ring, then sleeps on a futex until the parent
+// publishes the drawn PID once for everybody. No worker and no system call per message except the futex ones.
+void participate_shm(registry_t *registry, int index) {
+    pid_t child_pid = getpid();
+    int slot = __atomic_fetch_add(&registry->registered, 1, __ATOMIC_SEQ_CST);
+    registry->pids[slot] = child_pid;
+    registry->registered_ns[slot] = now_ns();
+    finish_one(registry, registry->participants, registration_done);
+
+    futex_wait_while(&registry->published, 0);
+    registry->delivered_ns[index] = now_ns();
+    pid_t drawn_pid = registry->drawn_pid;
+    __atomic_fetch_add(&registry->acknowledged, 1, __ATOMIC_SEQ_CST); // Ack: the result arrived
+    finish_one(registry, registry->registered, result_done);
+    if (drawn_pid == child_pid && verbose)
+        printf("\n%d: FUI SORTEADO!\n", child_pid);
+    exit(0);
+}
+
+// Child process code
+void run_participant(const options_t *options, registry_t *registry, int index) {
+    int sockfd_child;
+
+    // Ready for SIGUSR1 before registering, since the parent may signal as soon as the PID arrives. Both
+    // signals stay blocked except inside sigsuspend, so none can slip in between testing proceed and waiting.
+    sigset_t blocked, wait_mask;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGUSR1);
+    sigaddset(&blocked, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &blocked, &wait_mask);
+    signal(SIGUSR1, signal_handler);
+
+    // Every participant starts together once all of them exist, so fork time stays out of the measurements
+    futex_wait_while(&registry->gate, 0);
+    if (options->transport == TRANSPORT_SHM)
+        participate_shm(registry, index);
+
+    // Connecting to the server
+    sockfd_child = connect_server(options->transport);
+
+    // Sending the child's PID
+    pid_t child_pid = getpid();
+    if (verbose)
+        printf("Child process %d connected and sending PID\n", child_pid);
+    if (write(sockfd_child, &child_pid, sizeof(child_pid)) < 0)
+        error("Error sending PID"); // Handle PID sending error
+
+    if (options->persistent) {
+        // Receiving the drawn PID on the same connection, pushed by the parent
+        pid_t drawn_pid;
+        if (read(sockfd_child, &drawn_pid, sizeof(drawn_pid)) != sizeof(drawn_pid))
+            error("Error receiving drawn PID"); // Handle drawn PID receiving error
+        registry->delivered_ns[index] = now_ns();
+        if (write(sockfd_child, &child_pid, sizeof(child_pid)) < 0) // Ack: the result arrived
+            error("Error sending ack"); // Handle ack sending error
+        if (drawn_pid == child_pid && verbose)
+            printf("\n%d: FUI SORTEADO!\n", child_pid);
+        close(sockfd_child);
+        exit(0);
+    }
+
+    // Closing the child's socket after sending the PID
+    close(sockfd_child);
+
+    // Waiting for the signal from the parent
+    while (!proceed) sigsuspend(&wait_mask); // Wait for the signal
+
+    // Connecting again to receive the drawn PID
+    sockfd_child = connect_server(options->transport);
+
+    // Receiving the drawn PID
+    pid_t drawn_pid;
+    if (read(sockfd_child, &drawn_pid, sizeof(drawn_pid)) < 0)
+        error("Error receiving drawn PID"); // Handle drawn PID receiving error
+    registry->delivered_ns[index] = now_ns();
+
+    // The winner must be ready for SIGUSR2 before acking, since the parent signals right after the last ack
+    if (drawn_pid == child_pid) {
+        proceed = 0;               // Still set by SIGUSR1
+        signal(SIGUSR2, signal_handler);
+    }
+    if (write(sockfd_child, &child_pid, sizeof(child_pid)) < 0)
+        error("Error sending ack"); // Handle ack sending error
+
+    // If the drawn PID matches the child's PID, wait for the final signal
+    if (drawn_pid == child_pid) {
+        while (!proceed) sigsuspend(&wait_mask); // Wait for the final signal
+        if (verbose)
+            printf("\n%d: FUI SORTEADO!\n", child_pid);
+    }
+
+    // Closing the child's socket
+    close(sockfd_child);
+
+    // Exit the child process
+    exit(0);
+}
+
+// Every participant connection is a descriptor in some worker, so allow as many as the hard limit permits
+void raise_fd_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Runs one complete lottery and returns its registry, with the timestamps of every participant, for the caller
+// to report and unmap
+registry_t *run_lottery(const options_t *options, size_t *registry_size) {
+    int participants = options->participants;
+    int workers = options->transport == TRANSPORT_SHM ? 0 : options->workers; // shm needs no server process
+
+    // Registry shared by the parent, the workers and (shm transport) the children, sized for the participant count
+    *registry_size = sizeof(registry_t) + participants * (sizeof(pid_t) + 2 * sizeof(int64_t));
+    registry_t *registry = mmap(NULL, *registry_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (registry == MAP_FAILED)
+        error("Error creating shared registry"); // Handle mmap error
+    registry->participants = participants;
+    registry->registered_ns = (int64_t *) (registry->pids + participants);
+    registry->delivered_ns = registry->registered_ns + participants;
+
+    registration_done = eventfd(0, 0);
+    draw_ready = eventfd(0, 0);
+    result_done = eventfd(0, 0);
+    if (registration_done < 0 || draw_ready < 0 || result_done < 0)
+        error("Error creating latches");   // Handle eventfd error
+
+    // Every listener is bound before any participant exists, so no connection is refused
+    int *listeners = malloc((workers + 1) * sizeof(int));
+    if (listeners == NULL)
+        error("Error allocating workers"); // Handle allocation error
+    for (int w = 0; w < workers; w++)
+        listeners[w] = options->transport == TRANSPORT_UNIX && w > 0 ? dup(listeners[0]) : open_listener(options->transport);
+
+    if (verbose) {
+        if (options->transport == TRANSPORT_SHM)
+            printf("Parent process is waiting for registrations in shared memory\n");
+        else if (options->transport == TRANSPORT_UNIX)
+            printf("Parent process is listening for connections on %s with %d workers\n", SOCKET_PATH, workers);
+        else
+            printf("Parent process is listening for connections on port %d with %d workers\n", PORT, workers);
+    }
+    fflush(stdout);                        // Otherwise every forked process flushes its own copy
+
+    // Creating the acceptor workers
+    for (int w = 0; w < workers; w++) {
         pid_t pid = fork();
         if (pid < 0)
-            error("Error creating child process"); // Handle fork error
+            error("Error creating worker process"); // Handle fork error
         if (pid == 0) {
-            // Child process code
-            int sockfd_child;
-            struct sockaddr_in serv_addr_child;
-
-            // Creating the child's socket
-            sockfd_child = socket(AF_INET, SOCK_STREAM, 0);
-            if (sockfd_child < 0)
-                error("Error opening child socket"); // Handle child socket error
-
-            // Configuring the server address for the child
-            serv_addr_child.sin_family = AF_INET;
-            serv_addr_child.sin_addr.s_addr = inet_addr("127.0.0.1");
-            serv_addr_child.sin_port = htons(PORT);
-
-            // Connecting to the server
-            if (connect(sockfd_child, (struct sockaddr *) &serv_addr_child, sizeof(serv_addr_child)) < 0)
-                error("Error connecting child socket"); // Handle child connection error
-
-            // Sending the child's PID
-            pid_t child_pid = getpid();
-            printf("Child process %d connected and sending PID\n", child_pid);
-            if (write(sockfd_child, &child_pid, sizeof(child_pid)) < 0)
-                error("Error sending PID"); // Handle PID sending error
-
-            // Closing the child's socket after sending the PID
-            close(sockfd_child);
-
-            // Waiting for the signal from the parent
-            signal(SIGUSR1, signal_handler);
-            while (!proceed) pause(); // Wait for the signal
-
-            // Connecting again to receive the drawn PID
-            sockfd_child = socket(AF_INET, SOCK_STREAM, 0);
-            if (sockfd_child < 0)
-                error("Error opening child socket"); // Handle child socket error
-
-            // Configuring the server address for the child
-            serv_addr_child.sin_family = AF_INET;
-            serv_addr_child.sin_addr.s_addr = inet_addr("127.0.0.1");
-            serv_addr_child.sin_port = htons(PORT);
-
-            // Connecting to the server
-            if (connect(sockfd_child, (struct sockaddr *) &serv_addr_child, sizeof(serv_addr_child)) < 0)
-                error("Error connecting child socket"); // Handle child connection error
-
-            // Receiving the drawn PID
-            pid_t drawn_pid;
-            if (read(sockfd_child, &drawn_pid, sizeof(drawn_pid)) < 0)
-                error("Error receiving drawn PID"); // Handle drawn PID receiving error
-
-            // If the drawn PID matches the child's PID, wait for the final signal
-            if (drawn_pid == child_pid) {
-                signal(SIGUSR2, signal_handler);
-                while (!proceed) pause(); // Wait for the final signal
-                printf("\n%d: FUI SORTEADO!\n", child_pid);
-            }
-
-            // Closing the child's socket
-            close(sockfd_child);
-
-            // Exit the child process
-            exit(0);
+            for (int other = 0; other < workers; other++)
+                if (other != w)
+                    close(listeners[other]);
+            worker_t worker = { w, -1, listeners[w], registry, NULL, 0, 0 };
+            run_worker(&worker, options->persistent);
         }
     }
+    for (int w = 0; w < workers; w++)
+        close(listeners[w]);
+    free(listeners);
 
-    // Receiving connections from children
-    for (int i = 0; i < NUM_CHILDREN; i++) {
-        clilen = sizeof(cli_addr);
-        newsockfd = accept(sockfd, (struct sockaddr *) &cli_addr, &clilen);
-        if (newsockfd < 0)
-            error("Error accepting connection"); // Handle connection acceptance error
+    // Creating child processes, unless the participants connect from outside
+    for (int i = 0; i < participants && !options->external; i++) {
+        pid_t pid = fork();
+        if (pid < 0)
+            error("Error creating child process"); // Handle fork error
+        if (pid == 0)
+            run_participant(options, registry, i);
+    }
 
-        // Receiving the child's PID
-        pid_t received_pid;
-        if (read(newsockfd, &received_pid, sizeof(received_pid)) < 0)
-            error("Error reading PID"); // Handle PID reading error
-        printf("Parent process received PID %d\n", received_pid);
-        pids_received[i] = received_pid;
+    // Opening the gate: registration latency runs from here
+    registry->start_ns = now_ns();
+    __atomic_store_n(&registry->gate, 1, __ATOMIC_SEQ_CST);
+    futex_wake_all(&registry->gate);
 
-        // Closing the connection with the child
-        close(newsockfd);
-    }
+    // Waiting for every worker to finish its share of the registrations
+    wait_latch(registration_done);
+    int registered = registry->registered;
+    if (registered == 0)
+        error("No child process registered"); // Handle the case where every registration failed
+    if (verbose)
+        printf("Parent process registered %d participants in %.3f ms\n", registered, (now_ns() - registry->start_ns) / 1e6);
 
-    // Drawing a PID
+    // Drawing a PID; the draw latency runs from here to the last participant's ack
     srand(time(NULL));
-    int drawn_index = rand() % NUM_CHILDREN;
-    pid_t drawn_pid = pids_received[drawn_index];
-    printf("\nPID SORTEADO: %d\n\n", drawn_pid);
-
-    // Sending a signal to all child processes to proceed
-    for (int i = 0; i < NUM_CHILDREN; i++) {
-        kill(pids_received[i], SIGUSR1);
+    int drawn_index = rand() % registered;
+    pid_t drawn_pid = registry->pids[drawn_index];
+    if (verbose)
+        printf("\nPID SORTEADO: %d\n\n", drawn_pid);
+    fflush(stdout);
+
+    // Publishing the draw to the workers (socket transports) or directly to the children (shm transport)
+    registry->drawn_pid = drawn_pid;
+    __atomic_store_n(&registry->finished, 0, __ATOMIC_SEQ_CST);
+    registry->published_ns = now_ns();
+    __atomic_store_n(&registry->published, 1, __ATOMIC_SEQ_CST);
+    futex_wake_all(&registry->published);
+    fire_latch(draw_ready);
+
+    int signals = !options->persistent && options->transport != TRANSPORT_SHM;
+    if (signals) {
+        // Sending a signal to all child processes to proceed
+        for (int i = 0; i < registered; i++) {
+            kill(registry->pids[i], SIGUSR1);
+        }
     }
 
-    // Informing the drawn PID to children
-    for (int i = 0; i < NUM_CHILDREN; i++) {
-        clilen = sizeof(cli_addr);
-        newsockfd = accept(sockfd, (struct sockaddr *) &cli_addr, &clilen);
-        if (newsockfd < 0)
-            error("Error accepting connection"); // Handle connection acceptance error
+    // Waiting for every child to acknowledge the result, through whichever worker served it
+    wait_latch(result_done);
+
+    // Sending the final signal to the drawn child process as soon as every child acknowledged the result
+    if (signals)
+        kill(drawn_pid, SIGUSR2);
+    int64_t draw_end = now_ns();
+    if (verbose)
+        printf("Draw latency: %.3f ms (%d participants acknowledged the result)\n",
+               (draw_end - registry->published_ns) / 1e6, registry->acknowledged);
+
+    // Reaping workers and children, so that the next run starts clean
+    while (wait(NULL) > 0 || errno == EINTR)
+        ;
+    close(registration_done);
+    close(draw_ready);
+    close(result_done);
+    if (options->transport == TRANSPORT_UNIX)
+        unlink(SOCKET_PATH);
+    return registry;
+}
 
-        // Sending the drawn PID to the child
-        if (write(newsockfd, &drawn_pid, sizeof(drawn_pid)) < 0)
-            error("Error sending drawn PID"); // Handle drawn PID sending error
+int compare_int64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Prints p50, p99 and max, in microseconds, of the timestamps relative to start (0 entries are ignored)
+void print_percentiles(const int64_t *stamps, int count, int64_t start) {
+    int64_t *latencies = malloc((count + 1) * sizeof(int64_t));
+    if (latencies == NULL)
+        error("Error allocating latencies"); // Handle allocation error
+    int n = 0;
+    for (int i = 0; i < count; i++)
+        if (stamps[i] != 0)
+            latencies[n++] = stamps[i] - start;
+    qsort(latencies, n, sizeof(int64_t), compare_int64);
+    if (n == 0)
+        printf(" %10s %10s %10s", "-", "-", "-");
+    else
+        printf(" %10.1f %10.1f %10.1f", latencies[(n - 1) / 2] / 1e3, latencies[(int) ((n - 1) * 0.99)] / 1e3,
+               latencies[n - 1] / 1e3);
+    free(latencies);
+}
 
-        // Closing the connection with the child
-        close(newsockfd);
+// Runs the same lottery over every transport and compares registration and result-delivery latency. Socket
+// transports run in persistent mode, so all three deliver the result by pushing it to a waiting participant.
+void run_benchmark(options_t options) {
+    verbose = 0;
+    options.persistent = 1;
+    printf("%d participants, %d workers; latencies in us from the start gate (registration) or the draw (result)\n",
+           options.participants, options.workers);
+    printf("%-9s %10s %10s %10s %10s %10s %10s\n", "transport", "reg p50", "reg p99", "reg max", "res p50", "res p99",
+           "res max");
+    for (int t = 0; t < 3; t++) {
+        options.transport = t;
+        size_t registry_size;
+        registry_t *registry = run_lottery(&options, &registry_size);
+        printf("%-9s", transport_names[t]);
+        print_percentiles(registry->registered_ns, registry->registered, registry->start_ns);
+        print_percentiles(registry->delivered_ns, options.participants, registry->published_ns);
+        printf("\n");
+        fflush(stdout);
+        munmap(registry, registry_size);
     }
+}
+
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--persistent] [--participants <n>] [--workers <n>] [--transport tcp|unix|shm] [--bench]\n"
+            "          [--external] [--quiet]\n", program);
+    fprintf(stderr, "  --persistent        one connection per participant, result pushed on it\n");
+    fprintf(stderr, "  --participants <n>  number of child processes (default: %d)\n", NUM_CHILDREN);
+    fprintf(stderr, "  --workers <n>       acceptor processes sharing the listener (default: online CPUs)\n");
+    fprintf(stderr, "  --transport <name>  tcp (default), unix (AF_UNIX stream) or shm (shared memory and futexes)\n");
+    fprintf(stderr, "  --bench             compare the latency of the three transports\n");
+    fprintf(stderr, "  --external          serve external clients (see loadgen.c) instead of forking participants;\n");
+    fprintf(stderr, "                      implies --persistent, and their 4-byte IDs stand in for PIDs\n");
+    fprintf(stderr, "  --quiet             no per-participant messages\n");
+}
 
-    // Sending the final signal to the drawn child process to proceed
-    sleep(1); // Ensuring all previous communications are complete before sending the final signal
-    kill(drawn_pid, SIGUSR2);
+int main(int argc, char *argv[]) {
+    options_t options = { TRANSPORT_TCP, 0, NUM_CHILDREN, 1, 0 };
+    int bench = 0;
+    if (sysconf(_SC_NPROCESSORS_ONLN) > 0)
+        options.workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Protocol mode: signals and a second connection (default) or one persistent connection per child
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--persistent") == 0)
+            options.persistent = 1;
+        else if (strcmp(argv[i], "--participants") == 0 && i + 1 < argc)
+            options.participants = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            options.workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--transport") == 0 && i + 1 < argc)
+            options.transport = parse_transport(argv[++i]);
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench = 1;
+        else if (strcmp(argv[i], "--external") == 0)
+            options.external = options.persistent = 1; // Nobody to signal: the result goes back on the connection
+        else if (strcmp(argv[i], "--quiet") == 0)
+            verbose = 0;
+        else
+            options.participants = 0;      // Reported below
+    }
+    if (options.participants <= 0 || options.workers <= 0 || (int) options.transport < 0 ||
+        (options.external && (bench || options.transport == TRANSPORT_SHM))) {
+        usage(argv[0]);
+        return 1;
+    }
+    raise_fd_limit();
 
-    // Closing the parent's socket
-    close(sockfd);
+    if (bench) {
+        run_benchmark(options);
+        return 0;
+    }
+    size_t registry_size;
+    registry_t *registry = run_lottery(&options, &registry_size);
+    munmap(registry, registry_size);
 
     return 0;
 }
@@ -1,99 +1,276 @@
 #include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
-#define N 5                        // Number of philosophers
+#define DEFAULT_N 5                // Default number of philosophers
 #define THINKING 'P'               // State for thinking
 #define HUNGRY 'F'                 // State for hungry
 #define EATING 'C'                 // State for eating
-#define LEFT (N - 1)               // Value representing the left neighbor offset
-#define RIGHT (N - LEFT)           // Value representing the right neighbor offset
 #define STATES 3                   // Number of states (THINKING, HUNGRY, EATING)
+#define CACHE_LINE 64              // Per-philosopher data is padded to this, so counters don't share lines
 
-char state[N];                     // Array to track the state of each philosopher
-pthread_mutex_t mutex;             // Mutex to protect the critical section
-pthread_mutex_t philosophers[N];   // Array of mutexes, one for each philosopher
-pthread_t thread_id[N];            // Array of thread identifiers for each philosopher
+typedef struct {
+    int id;                        // Philosopher number
+    unsigned seed;                 // rand_r seed: rand() takes a global lock
+    long meals;                    // Meals eaten so far
+} __attribute__((aligned(CACHE_LINE))) philosopher_t;
+
+int n = DEFAULT_N;                 // Number of philosophers, chosen at runtime
+int global_engine = 0;             // 1: original algorithm, one mutex over the whole state array
+int verbose = 1;                   // Print the states on every change
+long think_us = -1;                // Thinking time in microseconds (-1: 1 to STATES seconds, as originally)
+long eat_us = -1;                  // Eating time in microseconds (-1: 1 to STATES seconds, as originally)
+volatile int running = 1;          // Cleared when a timed run ends
+
+char *state;                       // Array to track the state of each philosopher
+pthread_mutex_t mutex;             // Mutex to protect the critical section (global engine)
+pthread_mutex_t *philosophers;     // Array of mutexes, one for each philosopher (global engine)
+pthread_mutex_t *locks;            // Array of mutexes, one guarding each state (neighbour engine)
+pthread_cond_t *can_eat;           // Array of conditions, signalled when a neighbour lets philosopher i eat
+pthread_t *thread_id;              // Array of thread identifiers for each philosopher
+
+// Neighbours of philosopher i
+int left(int i)
+{
+    return (i + n - 1) % n;
+}
+
+int right(int i)
+{
+    return (i + 1) % n;
+}
 
 // Function to print the states of all philosophers
-void print_states() 
+void print_states()
+{
+    if (!verbose)
+        return;
+    char *line = (char*) malloc(n + 2);  // One write per line, so concurrent prints don't interleave
+    for (int i(0); i < n; i++)
+        line[i] = __atomic_load_n(&state[i], __ATOMIC_RELAXED);
+    line[n] = '\n';
+    line[n + 1] = '\0';
+    fputs(line, stdout);
+    free(line);
+}
+
+void set_state(int i, char s)
 {
-    for (int i(0); i < N; i++)
-        printf("%c", state[i]);
-    printf("\n");
+    __atomic_store_n(&state[i], s, __ATOMIC_RELAXED); // Atomic only for print_states, which reads without locks
+    print_states();                    // Print the states
 }
 
 // Function to test if philosopher i can start eating
-void test(int i) 
+void test(int i)
 {
     // Check if philosopher i is hungry and both neighbors are not eating
-    if (state[i] == HUNGRY && state[(i + LEFT) % N] != EATING && state[(i + RIGHT) % N] != EATING) {
-        state[i] = EATING;             // Set the state to eating
-        print_states();                // Print the states
-        pthread_mutex_unlock(&philosophers[i]); // Unlock the philosopher's mutex
+    if (state[i] == HUNGRY && state[left(i)] != EATING && state[right(i)] != EATING) {
+        set_state(i, EATING);          // Set the state to eating
+        if (global_engine)
+            pthread_mutex_unlock(&philosophers[i]); // Unlock the philosopher's mutex
+        else
+            pthread_cond_signal(&can_eat[i]); // Wake the philosopher, which waits holding nothing but its own lock
+    }
+}
+
+// Neighbour engine: locks the states of philosophers center - radius .. center + radius, always in ascending index
+// order so that overlapping windows cannot deadlock. Returns how many locks are held, listed in held.
+int lock_window(int center, int radius, int *held)
+{
+    int count(0);
+    for (int d(-radius); d <= radius; d++) {
+        int k = (center + d + n) % n;
+        int pos(count);
+        while (pos > 0 && held[pos - 1] > k)
+            pos--;
+        if (pos > 0 && held[pos - 1] == k)
+            continue;                  // Small tables wrap around onto the same philosopher
+        memmove(&held[pos + 1], &held[pos], (count - pos) * sizeof(int));
+        held[pos] = k;
+        count++;
     }
+    for (int j(0); j < count; j++)
+        pthread_mutex_lock(&locks[held[j]]);
+    return count;
+}
+
+void unlock_window(const int *held, int count)
+{
+    for (int j(count - 1); j >= 0; j--)
+        pthread_mutex_unlock(&locks[held[j]]);
 }
 
 // Function for philosopher i to take forks (start eating)
-void take_forks(int i) 
+void take_forks(int i)
 {
+    if (!global_engine) {
+        // Neighbour engine: the same protocol as below, but test(i) only reads i and its two neighbours, so
+        // only their locks are taken instead of a mutex over the whole table
+        int held[5];
+        int count = lock_window(i, 1, held);
+        set_state(i, HUNGRY);          // Set the state to hungry
+        test(i);                       // Test if the philosopher can eat
+        for (int j(0); j < count; j++)
+            if (held[j] != i)
+                pthread_mutex_unlock(&locks[held[j]]);
+        while (state[i] != EATING)     // A neighbour's put_forks grants the forks under this lock
+            pthread_cond_wait(&can_eat[i], &locks[i]);
+        pthread_mutex_unlock(&locks[i]);
+        return;
+    }
+
     pthread_mutex_lock(&mutex);        // Lock the global mutex
-    state[i] = HUNGRY;                 // Set the state to hungry
-    print_states();                    // Print the states
+    set_state(i, HUNGRY);              // Set the state to hungry
     test(i);                           // Test if the philosopher can eat
     pthread_mutex_unlock(&mutex);      // Unlock the global mutex
     pthread_mutex_lock(&philosophers[i]); // Lock the philosopher's mutex
 }
 
 // Function for philosopher i to put down forks (stop eating)
-void put_forks(int i) 
+void put_forks(int i)
 {
+    if (!global_engine) {
+        // test() on a neighbour also reads that neighbour's other neighbour: lock i - 2 .. i + 2
+        int held[5];
+        int count = lock_window(i, 2, held);
+        set_state(i, THINKING);        // Set the state to thinking
+        test(left(i));                 // Test if the left neighbor can eat
+        test(right(i));                // Test if the right neighbor can eat
+        unlock_window(held, count);
+        return;
+    }
+
     pthread_mutex_lock(&mutex);        // Lock the global mutex
-    state[i] = THINKING;               // Set the state to thinking
-    print_states();                    // Print the states
-    test((i + LEFT) % N);              // Test if the left neighbor can eat
-    test((i + RIGHT) % N);             // Test if the right neighbor can eat
+    set_state(i, THINKING);            // Set the state to thinking
+    test(left(i));                     // Test if the left neighbor can eat
+    test(right(i));                    // Test if the right neighbor can eat
     pthread_mutex_unlock(&mutex);      // Unlock the global mutex
 }
 
+// Thinking or eating time
+void spend(philosopher_t *p, long us)
+{
+    if (us < 0)
+        sleep(rand_r(&p->seed) % STATES + 1); // Original timing
+    else if (us > 0)
+        usleep(us);
+}
+
 // Function for the philosopher thread
-void* philosopher(void* num) 
+void* philosopher(void* arg)
 {
-    int i = *(int*)num;                // Get the philosopher number
-    printf("Creating philo %d with forks %d and %d\n", i, i, (i + RIGHT) % N);
-    while (1) {                        // Infinite loop
-        sleep(rand() % STATES + 1);    // Philosopher is thinking
+    philosopher_t *p = (philosopher_t*) arg;
+    int i = p->id;                     // Get the philosopher number
+    if (verbose)
+        printf("Creating philo %d with forks %d and %d\n", i, i, right(i));
+    while (running) {                  // Until the timed run ends (forever by default)
+        spend(p, think_us);            // Philosopher is thinking
         take_forks(i);                 // Philosopher takes forks (starts eating)
-        sleep(rand() % STATES + 1);    // Philosopher is eating
+        spend(p, eat_us);              // Philosopher is eating
+        p->meals++;
         put_forks(i);                  // Philosopher puts down forks (stops eating)
     }
+    return NULL;
+}
+
+void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [N] [--global] [--seconds <s>] [--think-us <us>] [--eat-us <us>] [--quiet]\n", program);
+    fprintf(stderr, "  N               number of philosophers (default: %d)\n", DEFAULT_N);
+    fprintf(stderr, "  --global        original algorithm: one mutex over all states\n");
+    fprintf(stderr, "  --seconds <s>   stop after s seconds and report meals per second (default: run forever)\n");
+    fprintf(stderr, "  --think-us <us> thinking time (default: 1 to %d s at random)\n", STATES);
+    fprintf(stderr, "  --eat-us <us>   eating time (default: 1 to %d s at random)\n", STATES);
+    fprintf(stderr, "  --quiet         do not print the states\n");
 }
 
-int main() 
+int main(int argc, char *argv[])
 {
-    int philosopher_ids[N];            // Array to hold philosopher IDs
+    int seconds(0);
+    for (int i(1); i < argc; i++) {
+        if (strcmp(argv[i], "--global") == 0)
+            global_engine = 1;
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--think-us") == 0 && i + 1 < argc)
+            think_us = atol(argv[++i]);
+        else if (strcmp(argv[i], "--eat-us") == 0 && i + 1 < argc)
+            eat_us = atol(argv[++i]);
+        else if (strcmp(argv[i], "--quiet") == 0)
+            verbose = 0;
+        else if (argv[i][0] != '-')
+            n = atoi(argv[i]);
+        else
+            n = 0;                      // Reported below
+    }
+    if (n < 2 || seconds < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    state = (char*) malloc(n);
+    philosophers = (pthread_mutex_t*) malloc(n * sizeof(pthread_mutex_t));
+    locks = (pthread_mutex_t*) malloc(n * sizeof(pthread_mutex_t));
+    can_eat = (pthread_cond_t*) malloc(n * sizeof(pthread_cond_t));
+    thread_id = (pthread_t*) malloc(n * sizeof(pthread_t));
+    philosopher_t *philosopher_data;    // Array to hold philosopher IDs, seeds and meal counts
+    if (state == NULL || philosophers == NULL || locks == NULL || can_eat == NULL || thread_id == NULL ||
+        posix_memalign((void**) &philosopher_data, CACHE_LINE, n * sizeof(philosopher_t)) != 0) {
+        perror("Error allocating philosophers");
+        return 1;
+    }
 
     pthread_mutex_init(&mutex, NULL);  // Initialize the global mutex
-    for (int i(0); i < N; i++) {
+    for (int i(0); i < n; i++) {
         pthread_mutex_init(&philosophers[i], NULL); // Initialize each philosopher's mutex
         pthread_mutex_lock(&philosophers[i]);       // Lock each philosopher's mutex initially
+        pthread_mutex_init(&locks[i], NULL);        // Initialize each state's mutex
+        pthread_cond_init(&can_eat[i], NULL);
         state[i] = THINKING;            // Set each philosopher's state to thinking
-        philosopher_ids[i] = i;         // Assign IDs to philosophers
+        philosopher_data[i].id = i;     // Assign IDs to philosophers
+        philosopher_data[i].seed = time(NULL) + i;
+        philosopher_data[i].meals = 0;
     }
 
     print_states();                     // Print initial states
 
-    for (int i(0); i < N; i++)
-        pthread_create(&thread_id[i], NULL, philosopher, &philosopher_ids[i]); // Create philosopher threads
+    for (int i(0); i < n; i++)
+        pthread_create(&thread_id[i], NULL, philosopher, &philosopher_data[i]); // Create philosopher threads
 
-    for (int i(0); i < N; i++)
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (seconds > 0) {
+        sleep(seconds);
+        __atomic_store_n(&running, 0, __ATOMIC_RELAXED); // Each philosopher stops after its current meal
+    }
+
+    for (int i(0); i < n; i++)
         pthread_join(thread_id[i], NULL); // Wait for all philosopher threads to finish
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    long meals(0);
+    for (int i(0); i < n; i++)
+        meals += philosopher_data[i].meals;
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s engine, %d philosophers: %ld meals in %.2f s (%.0f meals/s)\n", global_engine ? "global" : "neighbour",
+           n, meals, elapsed, meals / elapsed);
 
-    for (int i(0); i < N; i++)
+    for (int i(0); i < n; i++) {
         pthread_mutex_destroy(&philosophers[i]); // Destroy each philosopher's mutex
-        
+        pthread_mutex_destroy(&locks[i]);        // Destroy each state's mutex
+        pthread_cond_destroy(&can_eat[i]);
+    }
+
     pthread_mutex_destroy(&mutex);      // Destroy the global mutex
+    free(philosopher_data);
+    free(thread_id);
+    free(can_eat);
+    free(locks);
+    free(philosophers);
+    free(state);
 
-    return 0;                       
+    return 0;
 }
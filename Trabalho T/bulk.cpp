@@ -0,0 +1,371 @@
+/**
+ * Importação e exportação em lote entre árvores de diretórios (ou arquivos tar) e uma imagem
+ * do sistema de arquivos que simula EXT3
+ */
+
+#include "bulk.h"
+#include "image.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TAR_BLOCK 512
+
+/**
+ * @brief Agrupa uma lista de blocos em sequências contíguas (primeiro bloco, quantidade de blocos)
+ */
+static std::vector<std::pair<int, int>> blockRuns(const std::vector<int> &blocks)
+{
+    std::vector<std::pair<int, int>> runs;
+    for (int block : blocks) {
+        if (!runs.empty() && runs.back().first + runs.back().second == block)
+            runs.back().second++;
+        else
+            runs.push_back({block, 1});
+    }
+    return runs;
+}
+
+/**
+ * @brief Copia size bytes da posição atual de srcFd para os blocos de um inode
+ * @return true se todos os bytes foram copiados
+ */
+static bool copyFromFd(int srcFd, int imageFd, const IMAGE &image, int inode, int size)
+{
+    int blockSize = image.layout.blockSize;
+    for (auto run : blockRuns(inodeBlocks(image, inode))) {
+        loff_t offset = blockOffset(image.layout, run.first);
+        int length = std::min(run.second * blockSize, size);
+        size -= length;
+        while (length > 0) {                                             // Kernel-side copy, one call per run
+            ssize_t copied = copy_file_range(srcFd, NULL, imageFd, &offset, length, 0);
+            if (copied <= 0)
+                break;
+            length -= copied;
+        }
+
+        std::vector<char> buffer(blockSize);
+        while (length > 0) {                                             // Fallback for pipes and older kernels
+            ssize_t chunk = read(srcFd, buffer.data(), std::min(length, blockSize));
+            if (chunk <= 0 || pwrite(imageFd, buffer.data(), chunk, offset) != chunk)
+                return false;
+            offset += chunk;
+            length -= chunk;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Copia size bytes de um fluxo para os blocos de um inode, um bloco por vez
+ * @return true se todos os bytes foram copiados
+ */
+static bool copyFromStream(std::istream &src, int imageFd, const IMAGE &image, int inode, int size)
+{
+    int blockSize = image.layout.blockSize;
+    std::vector<char> buffer(blockSize);
+    for (int block : inodeBlocks(image, inode)) {
+        int length = std::min(blockSize, size);
+        if (!src.read(buffer.data(), length))
+            return false;
+        if (pwrite(imageFd, buffer.data(), length, blockOffset(image.layout, block)) != length)
+            return false;
+        size -= length;
+    }
+    return true;
+}
+
+/**
+ * @brief Importa recursivamente o conteúdo de hostDir para o diretório parent da imagem
+ * @return quantidade de entradas importadas ou -1 em caso de erro
+ */
+static int importDir(int imageFd, IMAGE &image, int parent, const std::string &hostDir)
+{
+    DIR *dir = opendir(hostDir.c_str());
+    if (dir == NULL)
+        return -1;
+
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir))
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+            names.push_back(entry->d_name);
+    closedir(dir);
+    std::sort(names.begin(), names.end());                               // Deterministic layout
+
+    int imported(0);
+    for (const std::string &name : names) {
+        std::string hostPath = hostDir + "/" + name;
+        struct stat st;
+        if (stat(hostPath.c_str(), &st) < 0)
+            return -1;
+
+        if (S_ISDIR(st.st_mode)) {
+            int inode = createEntry(imageFd, image, parent, name, true, 0);
+            int children = inode < 0 ? -1 : importDir(imageFd, image, inode, hostPath);
+            if (children < 0)
+                return -1;
+            imported += 1 + children;
+        }
+        else if (S_ISREG(st.st_mode)) {
+            int inode = createEntry(imageFd, image, parent, name, false, st.st_size);
+            if (inode < 0)
+                return -1;
+            int srcFd = open(hostPath.c_str(), O_RDONLY);
+            bool copied = srcFd >= 0 && copyFromFd(srcFd, imageFd, image, inode, st.st_size);
+            if (srcFd >= 0)
+                close(srcFd);
+            if (!copied)
+                return -1;
+            imported++;
+        }
+    }
+    return imported;
+}
+
+/**
+ * @brief Copia recursivamente um diretório do sistema de arquivos local para a raiz da imagem.
+ * A imagem é aberta e lida uma única vez; inodes e blocos são reservados em memória e os metadados
+ * são escritos uma única vez ao final. O sistema já deve ter sido inicializado.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param hostDir caminho do diretório no sistema de arquivos local
+ * @return quantidade de entradas importadas ou -1 em caso de erro
+ */
+int importTree(std::string fsFileName, std::string hostDir)
+{
+    int fd = open(fsFileName.c_str(), O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    IMAGE image;
+    int imported = loadImage(fd, image) ? importDir(fd, image, ROOT_INODE, hostDir) : -1;
+    if (imported >= 0 && !flushImage(fd, image))                         // Metadata is only written on success
+        imported = -1;
+    close(fd);
+    return imported;
+}
+
+/**
+ * @brief Lê um número octal de um campo do cabeçalho tar
+ */
+static long tarNumber(const char *field, int size)
+{
+    std::string digits(field, strnlen(field, size));
+    return strtol(digits.c_str(), NULL, 8);
+}
+
+/**
+ * @brief Cria (se necessário) todos os diretórios de um caminho
+ * @return inode do último diretório ou -1 em caso de erro
+ */
+static int makeDirs(int fd, IMAGE &image, const std::vector<std::string> &components, int *created)
+{
+    int dir(ROOT_INODE);
+    for (const std::string &name : components) {
+        int inode = findEntry(fd, image, dir, name);
+        if (inode < 0) {
+            inode = createEntry(fd, image, dir, name, true, 0);
+            if (inode < 0)
+                return -1;
+            (*created)++;
+        }
+        else if (image.inodes[inode].IS_DIR != ISDIR)
+            return -1;
+        dir = inode;
+    }
+    return dir;
+}
+
+/**
+ * @brief Importa as entradas de um arquivo tar (ustar) para a imagem, criando os diretórios intermediários.
+ * O conteúdo dos arquivos é copiado bloco a bloco, sem manter o arquivo inteiro em memória.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param tar fluxo com o conteúdo do arquivo tar
+ * @return quantidade de entradas importadas ou -1 em caso de erro
+ */
+int importTar(std::string fsFileName, std::istream &tar)
+{
+    int fd = open(fsFileName.c_str(), O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    IMAGE image;
+    int imported(0);
+    char header[TAR_BLOCK];
+    bool ok = loadImage(fd, image);
+    while (ok && tar.read(header, TAR_BLOCK) && header[0] != 0) {      // An empty header ends the archive
+        std::string path(header, strnlen(header, 100));                  // name
+        std::string prefix(header + 345, strnlen(header + 345, 155));    // ustar prefix
+        if (!prefix.empty())
+            path = prefix + "/" + path;
+        long size = tarNumber(header + 124, 12);
+        char type = header[156];
+
+        std::vector<std::string> components;
+        for (size_t start(0), end; start < path.size(); start = end + 1) {
+            end = path.find('/', start);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string name = path.substr(start, end - start);
+            if (!name.empty() && name != ".")
+                components.push_back(name);
+        }
+
+        long consumed(0);
+        if (type == '5' && !components.empty())                          // Directory
+            ok = makeDirs(fd, image, components, &imported) >= 0;
+        else if ((type == '0' || type == 0) && !components.empty()) {    // Regular file
+            std::string name = components.back();
+            components.pop_back();
+            int parent = makeDirs(fd, image, components, &imported);
+            int inode = parent < 0 ? -1 : createEntry(fd, image, parent, name, false, size);
+            ok = inode >= 0 && copyFromStream(tar, fd, image, inode, size);
+            consumed = size;
+            imported++;
+        }
+
+        long padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;    // Skip the rest of the data blocks
+        tar.ignore(padded - consumed);
+    }
+
+    if (!ok || !flushImage(fd, image))
+        imported = -1;
+    close(fd);
+    return imported;
+}
+
+/**
+ * @brief Escreve todos os bytes de um buffer em um descritor
+ */
+static bool writeAll(int fd, const char *buffer, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = write(fd, buffer, size);
+        if (written <= 0)
+            return false;
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Escreve um cabeçalho ustar
+ * @return false se o caminho não cabe em um cabeçalho ustar (prefixo de até 155 bytes e nome de até 100)
+ */
+static bool writeTarHeader(int tarFd, const std::string &path, bool isDir, int size)
+{
+    char header[TAR_BLOCK]{0};
+    std::string name = path, prefix;
+    if (name.size() > 100) {                                              // Split long paths into prefix/name
+        size_t split = name.rfind('/', std::min<size_t>(155, name.size() - 2)); // Never the trailing '/' of a dir
+        if (split == std::string::npos || name.size() - split - 1 > 100)
+            return false;
+        prefix = name.substr(0, split);
+        name = name.substr(split + 1);
+    }
+    strncpy(header, name.c_str(), 100);
+    snprintf(header + 100, 8, "%07o", isDir ? 0755 : 0644);               // mode
+    snprintf(header + 108, 8, "%07o", 0);                                 // uid
+    snprintf(header + 116, 8, "%07o", 0);                                 // gid
+    snprintf(header + 124, 12, "%011o", size);                            // size
+    snprintf(header + 136, 12, "%011o", 0);                               // mtime
+    header[156] = isDir ? '5' : '0';                                      // typeflag
+    memcpy(header + 257, "ustar", 6);                                     // magic
+    memcpy(header + 263, "00", 2);                                        // version
+    strncpy(header + 345, prefix.c_str(), 155);
+
+    memset(header + 148, ' ', 8);                                         // Checksum is computed with spaces in its field
+    unsigned int checksum(0);
+    for (int i(0); i < TAR_BLOCK; i++)
+        checksum += static_cast<unsigned char>(header[i]);
+    snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+    return writeAll(tarFd, header, TAR_BLOCK);
+}
+
+/**
+ * @brief Envia os blocos de um arquivo para o tar com sendfile, uma chamada por sequência contígua
+ */
+static bool sendFileData(int tarFd, int imageFd, const IMAGE &image, int inode)
+{
+    int size = static_cast<unsigned char>(image.inodes[inode].SIZE);
+    int blockSize = image.layout.blockSize;
+    int remaining = size;
+    for (auto run : blockRuns(inodeBlocks(image, inode))) {
+        off_t offset = blockOffset(image.layout, run.first);
+        int length = std::min(run.second * blockSize, remaining);
+        remaining -= length;
+        while (length > 0) {
+            ssize_t sent = sendfile(tarFd, imageFd, &offset, length);
+            if (sent <= 0) {                                               // Fallback when sendfile can't be used
+                std::vector<char> buffer(length);
+                if (pread(imageFd, buffer.data(), length, offset) != length || !writeAll(tarFd, buffer.data(), length))
+                    return false;
+                break;
+            }
+            length -= sent;
+        }
+    }
+
+    char padding[TAR_BLOCK]{0};
+    int rest = (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK;
+    return writeAll(tarFd, padding, rest);
+}
+
+/**
+ * @brief Exporta recursivamente um diretório da imagem
+ * @return quantidade de entradas exportadas ou -1 em caso de erro
+ */
+static int exportDir(int tarFd, int imageFd, IMAGE &image, int dir, const std::string &path)
+{
+    int exported(0);
+    for (int entry : dirEntries(imageFd, image, dir)) {
+        if (entry >= image.layout.numInodes || image.inodes[entry].IS_USED != USED)
+            continue;
+        std::string entryPath = path + inodeName(image, entry);
+        if (image.inodes[entry].IS_DIR == ISDIR) {
+            if (!writeTarHeader(tarFd, entryPath + "/", true, 0))
+                return -1;
+            int children = exportDir(tarFd, imageFd, image, entry, entryPath + "/");
+            if (children < 0)
+                return -1;
+            exported += 1 + children;
+        }
+        else {
+            int size = static_cast<unsigned char>(image.inodes[entry].SIZE);
+            if (!writeTarHeader(tarFd, entryPath, false, size) || !sendFileData(tarFd, imageFd, image, entry))
+                return -1;
+            exported++;
+        }
+    }
+    return exported;
+}
+
+/**
+ * @brief Exporta toda a árvore da imagem como um arquivo tar (ustar).
+ * Os blocos de dados são enviados com sendfile diretamente da imagem para o destino.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param tarFd descritor de arquivo (arquivo, pipe ou socket) que recebe o tar
+ * @return quantidade de entradas exportadas ou -1 em caso de erro
+ */
+int exportTar(std::string fsFileName, int tarFd)
+{
+    int fd = open(fsFileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    IMAGE image;
+    int exported = loadImage(fd, image) ? exportDir(tarFd, fd, image, ROOT_INODE, "") : -1;
+    char trailer[2 * TAR_BLOCK]{0};                                       // Two empty blocks end the archive
+    if (exported >= 0 && !writeAll(tarFd, trailer, sizeof(trailer)))
+        exported = -1;
+    close(fd);
+    return exported;
+}
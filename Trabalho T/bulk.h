@@ -0,0 +1,39 @@
+/**
+ * Importação e exportação em lote entre árvores de diretórios (ou arquivos tar) e uma imagem
+ * do sistema de arquivos que simula EXT3
+ */
+
+#ifndef bulk_h
+#define bulk_h
+#include <istream>
+#include <string>
+
+/**
+ * @brief Copia recursivamente um diretório do sistema de arquivos local para a raiz da imagem.
+ * A imagem é aberta e lida uma única vez; inodes e blocos são reservados em memória e os metadados
+ * são escritos uma única vez ao final. O sistema já deve ter sido inicializado.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param hostDir caminho do diretório no sistema de arquivos local
+ * @return quantidade de entradas importadas ou -1 em caso de erro
+ */
+int importTree(std::string fsFileName, std::string hostDir);
+
+/**
+ * @brief Importa as entradas de um arquivo tar (ustar) para a imagem, criando os diretórios intermediários.
+ * O conteúdo dos arquivos é copiado bloco a bloco, sem manter o arquivo inteiro em memória.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param tar fluxo com o conteúdo do arquivo tar
+ * @return quantidade de entradas importadas ou -1 em caso de erro
+ */
+int importTar(std::string fsFileName, std::istream &tar);
+
+/**
+ * @brief Exporta toda a árvore da imagem como um arquivo tar (ustar).
+ * Os blocos de dados são enviados com sendfile diretamente da imagem para o destino.
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param tarFd descritor de arquivo (arquivo, pipe ou socket) que recebe o tar
+ * @return quantidade de entradas exportadas ou -1 em caso de erro
+ */
+int exportTar(std::string fsFileName, int tarFd);
+
+#endif /* bulk_h */
@@ -3,23 +3,76 @@
  */
 
 #include "fs.h"
+#include "layout.h"
+#include "image.h"
+#include "trim.h"
+#include "trace.h"
 #include <fstream>
 #include <cmath>
 #include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define ROOT 1
-#define USED 1
-#define NOT_USED 0
-#define ISDIR 1
-#define IS_FILE 0
-#define INODE_SIZE 22
-#define DIRECT_BLOCKS_SIZE 3
-#define INDIRECT_BLOCKS_SIZE 3
-#define DOUBLE_INDIRECT_BLOCKS_SIZE 3
-#define SIZE 1
-#define BYTE_SIZE 8
-#define HEADER_SIZE 3
-#define NAME_SIZE 10
+
+/**
+ * @brief Maior índice de bloco direto entre todos os inodes de um vetor de inodes já lido
+ * @param layout geometria da imagem (LAYOUT ou FixedLayout)
+ * @param inodes bytes do vetor de inodes
+ */
+template <typename L>
+static int maxDirectBlock(const L &layout, const unsigned char *inodes)
+{
+    int maxBlock(0);
+    for (int i(0); i < layout.numInodes; i++) {                   // Fixed stride over the inode vector
+        const unsigned char *direct = inodes + i * INODE_SIZE + INODE_DIRECT_OFFSET;
+        for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
+            if (direct[j] > maxBlock)                             // If the block index is greater than the current one
+                maxBlock = direct[j];                             // Update the block index
+    }
+    return maxBlock;
+}
+
+/**
+ * @brief Maior índice de bloco direto entre todos os inodes, lendo o vetor de inodes de uma só vez
+ * @param file imagem aberta; o cursor fica no fim do vetor de inodes
+ * @param layout geometria da imagem
+ */
+static int maxDirectBlock(std::fstream &file, const LAYOUT &layout)
+{
+    std::vector<unsigned char> inodes(INODE_SIZE * layout.numInodes);
+    file.seekg(layout.inodeStart);                                // Skip the header and the bitmap
+    file.read(reinterpret_cast<char*>(inodes.data()), inodes.size());
+    return withLayout(layout, [&](const auto &l) { return maxDirectBlock(l, inodes.data()); });
+}
+
+/**
+ * @brief Perfura na imagem os blocos liberados que não são mais referenciados por nenhum inode usado
+ * @param fd descritor de arquivo aberto (escrita) da imagem
+ * @param image metadados já atualizados pela remoção
+ * @param freedBlocks blocos liberados pela remoção
+ */
+static void punchFreedBlocks(int fd, const IMAGE &image, const std::vector<int> &freedBlocks)
+{
+    std::vector<bool> referenced(image.layout.numBlocks, false);
+    withLayout(image.layout, [&](const auto &l) {
+        for (int i(0); i < l.numInodes; i++) {                    // For each inode
+            const INODE &inode = image.inodes[i];
+            if (inode.IS_USED != USED)
+                continue;
+            for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)           // Blocks still owned by a used inode
+                if (inode.DIRECT_BLOCKS[j] < l.numBlocks)
+                    referenced[inode.DIRECT_BLOCKS[j]] = true;
+        }
+    });
+
+    std::vector<int> unreferenced;
+    for (int block : freedBlocks)
+        if (!referenced[block])
+            unreferenced.push_back(block);
+    punchBlocks(fd, image.layout, unreferenced);
+}
 
 /**
  * @brief Inicializa um sistema de arquivos que simula EXT3
@@ -30,6 +83,8 @@
  */
 void initFs(std::string fsFileName, int blockSize, int numBlocks, int numInodes)
 {
+    TraceScope trace(TRACE_INIT_FS, {fsFileName}, {blockSize, numBlocks, numInodes});
+
     std::fstream file(fsFileName, std::ios::out | std::ios::binary | std::ios::trunc);
 
     // 3 bytes header declaration
@@ -85,6 +140,8 @@ void initFs(std::string fsFileName, int blockSize, int numBlocks, int numInodes)
  */
 void addFile(std::string fsFileName, std::string filePath, std::string fileContent)
 {
+    TraceScope trace(TRACE_ADD_FILE, {fsFileName, filePath, fileContent}, {});
+
     std::fstream file(fsFileName, std::ios::in | std::ios::out | std::ios::binary);
 
     char header[HEADER_SIZE];       // Header of the file
@@ -93,10 +150,12 @@ void addFile(std::string fsFileName, std::string filePath, std::string fileConte
     char numBlocks = header[1];     // Number of blocks
     char numInodes = header[2];     // Number of inodes 
 
-    int bitmapSize = std::ceil(numBlocks / BYTE_SIZE);  // Size of the bitmap
+    LAYOUT layout = makeLayout(static_cast<unsigned char>(blockSize), static_cast<unsigned char>(numBlocks),
+                               static_cast<unsigned char>(numInodes)); // Offsets computed once from the header
+    int bitmapSize = layout.bitmapSize;                           // Size of the bitmap
 
     INODE inode;
-    char freeInodeIndex;
+    char freeInodeIndex(0);
     // Finding a free inode index
     file.seekg(HEADER_SIZE + bitmapSize); // Skip the header and the bitmap                     
     for (int i(0); i < numInodes; i++) {                        
@@ -120,9 +179,9 @@ void addFile(std::string fsFileName, std::string filePath, std::string fileConte
         strncpy(pathName, filePath.substr(lastSlashIndex + 1).c_str(), NAME_SIZE);   // Get the file name as the path after the last slash
     }
 
-    int dirSize;
+    int dirSize(0);
     int inodeVectorSize(INODE_SIZE*numInodes);
-    char goToSize = (INODE_SIZE - (DOUBLE_INDIRECT_BLOCKS_SIZE + INDIRECT_BLOCKS_SIZE + DIRECT_BLOCKS_SIZE + SIZE));
+    constexpr int goToSize = INODE_SIZE_OFFSET;   // Offset of SIZE inside an inode
     // If the file isn't in the root directory, update the directory size
     if (dirName[0] != '/') {                   
         file.seekg(HEADER_SIZE + bitmapSize);     
@@ -141,15 +200,7 @@ void addFile(std::string fsFileName, std::string filePath, std::string fileConte
         }
     }
 
-    int blockIndex;
-    file.seekg(HEADER_SIZE + bitmapSize);             // Skip the header and the bitmap
-    // Find last block index for each inode
-    for (int i(0); i < numInodes; i++) { 
-        file.read(reinterpret_cast<char*>(&inode), INODE_SIZE);
-        for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
-            if (inode.DIRECT_BLOCKS[j] > blockIndex) // If the block index is greater than the current block index
-                blockIndex = inode.DIRECT_BLOCKS[j]; // Update the block index
-    }
+    int blockIndex = maxDirectBlock(file, layout);   // Find last block index used by any inode
     blockIndex++;                                    // The first free block comes after the last block index
 
     file.seekg(HEADER_SIZE + bitmapSize + (INODE_SIZE * freeInodeIndex)); // Cursor goes to the free inode
@@ -184,14 +235,7 @@ void addFile(std::string fsFileName, std::string filePath, std::string fileConte
     file.seekg(HEADER_SIZE + bitmapSize + goToSize); // Cursor goes to the directory size at the first inode
     file.put(subFiles);                              // Write number of subfiles
 
-    file.seekg(HEADER_SIZE + bitmapSize);            // Cursor goes to the first inode
-    char usedBlocks;
-    for (int i(0); i < numInodes; i++) {             // For each inode
-        file.read(reinterpret_cast<char*>(&inode), INODE_SIZE);
-        for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)  
-            if (inode.DIRECT_BLOCKS[j] > usedBlocks) // If the block is used
-                usedBlocks = inode.DIRECT_BLOCKS[j]; // Update the used blocks counter
-    }
+    char usedBlocks = maxDirectBlock(file, layout);  // Last block index used by any inode
 
     int bitmapInt(0);
     for (int i(0); i <= usedBlocks; i++) // For each used block
@@ -209,6 +253,8 @@ void addFile(std::string fsFileName, std::string filePath, std::string fileConte
  */
 void addDir(std::string fsFileName, std::string dirPath)
 {
+    TraceScope trace(TRACE_ADD_DIR, {fsFileName, dirPath}, {});
+
     std::fstream file(fsFileName, std::ios::in | std::ios::out | std::ios::binary);
 
     char header[HEADER_SIZE];       // Header of the file
@@ -217,14 +263,16 @@ void addDir(std::string fsFileName, std::string dirPath)
     char numBlocks = header[1];     // Number of blocks
     char numInodes = header[2];     // Number of inodes
 
-    int bitmapSize = std::ceil(numBlocks / BYTE_SIZE); // Size of the bitmap
+    LAYOUT layout = makeLayout(static_cast<unsigned char>(blockSize), static_cast<unsigned char>(numBlocks),
+                               static_cast<unsigned char>(numInodes)); // Offsets computed once from the header
+    int bitmapSize = layout.bitmapSize;                           // Size of the bitmap
 
     char pathName[NAME_SIZE];
     std::strcpy(pathName, dirPath.replace(0, 1, "").c_str()); // Remove the first slash from the path
     for (int i(dirPath.length()); i < NAME_SIZE; i++)         // Fill the rest of the name with zeros
         pathName[i] = 0;
 
-    char freeBlockIndex;
+    char freeBlockIndex(0);
     char bytes[blockSize*numBlocks];                               // Array to store block bytes
     int inodeVectorSize(INODE_SIZE*numInodes);
     file.seekg(HEADER_SIZE + bitmapSize + inodeVectorSize + ROOT); // Cursor goes to first byte of the first block
@@ -243,14 +291,7 @@ void addDir(std::string fsFileName, std::string dirPath)
     file.put(bitmapInt);                         // Write how many blocks are used
 
     INODE inode;
-    file.seekg(HEADER_SIZE + bitmapSize);                       // Cursor skips the header and the bitmap
-    int usedInodes;
-    for (int i(0); i < numInodes; i++) {                        // For each inode
-        file.read(reinterpret_cast<char*>(&inode), INODE_SIZE);
-        for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)             // For each direct block
-            if (inode.DIRECT_BLOCKS[j] > usedInodes)            // If the block is used
-                usedInodes = inode.DIRECT_BLOCKS[j];            // Update the used blocks counter
-    }
+    int usedInodes = maxDirectBlock(file, layout);   // Last block index used by any inode
 
     file.seekg(HEADER_SIZE + bitmapSize);                            // Cursor skips the header and the bitmap
     for (int i(0); i < numInodes; i++) {
@@ -266,7 +307,7 @@ void addDir(std::string fsFileName, std::string dirPath)
         }
     }
 
-    char GoToSize = (INODE_SIZE - (DOUBLE_INDIRECT_BLOCKS_SIZE + INDIRECT_BLOCKS_SIZE + DIRECT_BLOCKS_SIZE + SIZE));
+    constexpr int GoToSize = INODE_SIZE_OFFSET;   // Offset of SIZE inside an inode
     file.seekg(HEADER_SIZE + bitmapSize + GoToSize);               // Cursor goes to the directory size at the first inode 
     file.put(usedInodes);                                          // Write the number of subfiles  
     file.seekg(HEADER_SIZE + bitmapSize + inodeVectorSize + ROOT); // Cursor goes to the first byte of the first block
@@ -283,100 +324,27 @@ void addDir(std::string fsFileName, std::string dirPath)
  */
 void remove(std::string fsFileName, std::string path)
 {
-    std::fstream file(fsFileName, std::ios::in | std::ios::out | std::ios::binary);
-
-    char header[HEADER_SIZE];       // Header of the file
-    file.read(header, HEADER_SIZE); // Read the header
-    char blockSize = header[0];     // Block size
-    char numBlocks = header[1];     // Number of blocks
-    char numInodes = header[2];     // Number of inodes
-
-    int bitmapSize = std::ceil(numBlocks / BYTE_SIZE); // Size of the bitmap
-
-    char dirName[NAME_SIZE]{0};
-    char pathName[NAME_SIZE]{0};
-    // Extracting the directory name and the file name
-    char lastSlashIndex = path.find_last_of('/');
-    if (lastSlashIndex == 0) {                                // If the file is in the root directory
-        strncpy(dirName, "/", ROOT);                          // Get the directory name as root
-        strncpy(pathName, path.substr(1).c_str(), NAME_SIZE); // Get the file name as the rest of the path
-    } 
-    else {
-        strncpy(dirName, path.substr(1, lastSlashIndex - 1).c_str(), NAME_SIZE); // Get the directory name as the path before the last slash
-        strncpy(pathName, path.substr(lastSlashIndex + 1).c_str(), NAME_SIZE);   // Get the file name as the path after the last slash
-    }
-
-    INODE inode;
-    char pathIndex;
-    char dirIndex;
-    file.seekg(bitmapSize + HEADER_SIZE);  // Cursor skips the header and the bitmap
-    for (int i(0); i < numInodes; i++) {   // For each inode
-        file.read(reinterpret_cast<char*>(&inode), INODE_SIZE);
-        if (!strcmp(inode.NAME, pathName)) // If the inode name is the same as the path name 
-            pathIndex = i;                 // Set the path index
-        if (!strcmp(inode.NAME, dirName))  // If the inode name is the same as the directory name
-            dirIndex = i;                  // Set the directory index
-    }
-
-    INODE remove;
-    file.seekg(HEADER_SIZE + bitmapSize + (pathIndex * INODE_SIZE)); // Cursor goes to the inode to be removed
-    file.read(reinterpret_cast<char*>(&remove), INODE_SIZE);         // Read the inode to be removed
-    file.seekg(HEADER_SIZE + bitmapSize + (pathIndex * INODE_SIZE)); // Cursor goes to the inode to be removed
-    remove.IS_USED = NOT_USED;                                       // Mark the inode as not used
-    file.write(reinterpret_cast<const char*>(&remove), INODE_SIZE);  // Write the inode to the file
-
-    char goToSize = (INODE_SIZE - (DOUBLE_INDIRECT_BLOCKS_SIZE + INDIRECT_BLOCKS_SIZE + DIRECT_BLOCKS_SIZE + SIZE));
-    file.seekg(HEADER_SIZE + bitmapSize + (dirIndex * INODE_SIZE) + goToSize); // Cursor goes to the directory size at inode i
-    char dirSize;
-    file.read(&dirSize, sizeof(char)); // Read the directory size
-    file.seekg(-1, std::ios::cur);     // The read operation moves the cursor, so we need to move it back
-    dirSize--;                         // Decrement the directory size due to not using the inode anymore
-    file.put(dirSize);                 // Write the new directory size
-
-    INODE newInode;
-    int filledInodeCounter(0);
-    char usedInodeIndex;
-    file.seekg(HEADER_SIZE + bitmapSize); // Cursor skips the header and the bitmap
-    // Find the last inode used
-    for (int i(0); i < numInodes; i++) {  // For each inode
-        file.read(reinterpret_cast<char*>(&newInode), INODE_SIZE);
-        if (newInode.IS_USED == USED) {   // If the inode is used
-            filledInodeCounter++;         // Increment the filled inode counter
-            usedInodeIndex = i;           // Set the used inode index for the last inode used
-        }
-    }
-    if (filledInodeCounter == usedInodeIndex) {                                 // If the last inode used is the last inode
-        file.seekg(HEADER_SIZE + bitmapSize + (numInodes * INODE_SIZE) + ROOT); // Cursor goes to the first byte of the first block
-        file.put(usedInodeIndex);                                               // Write the index of the last inode used
+    TraceScope trace(TRACE_REMOVE, {fsFileName, path}, {});
+
+    int fd = open(fsFileName.c_str(), O_RDWR);
+    IMAGE image;
+    if (fd < 0 || !loadImage(fd, image)) { // Header, bitmap and inode vector in memory
+        if (fd >= 0)
+            close(fd);
+        return;
     }
 
-    file.seekg(HEADER_SIZE + bitmapSize);               // Cursor skips the header and the bitmap
-    char usedBlocks(0);
-    for (int i(0); i < numInodes; i++) {                // For each inode
-        file.read(reinterpret_cast<char*>(&newInode), INODE_SIZE);
-        for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
-            if (newInode.DIRECT_BLOCKS[j] > usedBlocks) // If more blocks are used
-                usedBlocks = newInode.DIRECT_BLOCKS[j]; // Update the used blocks counter
-    }
+    size_t lastSlashIndex = path.find_last_of('/');
+    int dirIndex = lookupPath(fd, image, path.substr(0, lastSlashIndex + 1)); // Directory that holds the entry
+    int pathIndex = lookupPath(fd, image, path);                             // Entry to be removed
 
-    int bitmapInt(0);
-    for (int i(0); i <= usedBlocks; i++) // For each used block
-            bitmapInt += (1 << i);       // Set a bit to one from the right to the left
-    switch (bitmapInt) {
-        case 63:
-            bitmapInt = 15;
-            break;
-        case 15:
-            bitmapInt = 7;
-            break;
-        case 7:
-            bitmapInt = 5;
-            break;
+    std::vector<int> freedBlocks;
+    if (dirIndex >= 0 && pathIndex > ROOT_INODE && removeTree(fd, image, dirIndex, pathIndex, freedBlocks)) {
+        flushImage(fd, image);                             // Bitmap, inode vector and directory blocks written once
+        if (punchOnFree())                                 // Release the bytes of the freed blocks if requested
+            punchFreedBlocks(fd, image, freedBlocks);
     }
-    file.seekg(HEADER_SIZE); // Cursor skips the header
-    file.put(bitmapInt);     // Write how many blocks are used
-
-    file.close();
+    close(fd);
 }
 
 /**
@@ -387,6 +355,8 @@ void remove(std::string fsFileName, std::string path)
  */
 void move(std::string fsFileName, std::string oldPath, std::string newPath)
 {
+    TraceScope trace(TRACE_MOVE, {fsFileName, oldPath, newPath}, {});
+
     std::fstream file(fsFileName, std::ios::in | std::ios::out | std::ios::binary);
 
     char header[HEADER_SIZE];       // Header of the file
@@ -395,7 +365,9 @@ void move(std::string fsFileName, std::string oldPath, std::string newPath)
     char numBlocks = header[1];     // Number of blocks
     char numInodes = header[2];     // Number of inodes
 
-    int bitmapSize = std::ceil(numBlocks / BYTE_SIZE); // Size of the bitmap
+    LAYOUT layout = makeLayout(static_cast<unsigned char>(blockSize), static_cast<unsigned char>(numBlocks),
+                               static_cast<unsigned char>(numInodes)); // Offsets computed once from the header
+    int bitmapSize = layout.bitmapSize;                           // Size of the bitmap
 
     char oldDirName[NAME_SIZE]{0};
     char oldPathName[NAME_SIZE]{0};
@@ -438,8 +410,8 @@ void move(std::string fsFileName, std::string oldPath, std::string newPath)
             newDirIndex = i;                      // Set the directory index to be added
     }
 
-    char goToName = (INODE_SIZE - (DOUBLE_INDIRECT_BLOCKS_SIZE + INDIRECT_BLOCKS_SIZE + DIRECT_BLOCKS_SIZE + SIZE + NAME_SIZE));
-    char goToSize = (INODE_SIZE - (DOUBLE_INDIRECT_BLOCKS_SIZE + INDIRECT_BLOCKS_SIZE + DIRECT_BLOCKS_SIZE + SIZE));
+    constexpr int goToName = INODE_NAME_OFFSET;   // Offset of NAME inside an inode
+    constexpr int goToSize = INODE_SIZE_OFFSET;   // Offset of SIZE inside an inode
     if (strcmp(oldPathName, newPathName) != 0) {                                    // If the file name is different
         file.seekg(HEADER_SIZE + bitmapSize + (pathIndex * INODE_SIZE) + goToName); // Cursor goes to the file name at inode i
         file.write(newPathName, strlen(newPathName));                               // Overwrite the file name
@@ -505,14 +477,7 @@ void move(std::string fsFileName, std::string oldPath, std::string newPath)
         int dirBlockIndex = (DIRECT_BLOCKS_SIZE * blockSize) + (dirSize - 1);
 
         if (dirSize > blockSize) {
-            char blockIndex(0);
-            file.seekg(HEADER_SIZE + bitmapSize);            // Cursor skips the header and the bitmap
-            for (int i(0); i < numInodes; i++) {             // For each inode
-                file.read(reinterpret_cast<char*>(&inode), INODE_SIZE);
-                for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
-                    if (inode.DIRECT_BLOCKS[j] > blockIndex) // If the block is used
-                        blockIndex = inode.DIRECT_BLOCKS[j]; // Update the used blocks counter
-            }
+            char blockIndex = maxDirectBlock(file, layout);  // Last block index used by any inode
             blockIndex++;                                    // The first free block comes after the last block index
 
             dirBlockIndex = (blockIndex * blockSize);
@@ -531,14 +496,7 @@ void move(std::string fsFileName, std::string oldPath, std::string newPath)
         file.seekg(HEADER_SIZE + bitmapSize + inodeVectorSize + ROOT + dirBlockIndex); // Cursor goes to block index to be written
         file.write(reinterpret_cast<char*>(&pathIndex), sizeof(char));                 // Write the path index to the block
 
-        char usedBlocks(0);
-        file.seekg(HEADER_SIZE + bitmapSize);               // Cursor skips the header and the bitmap
-        for (int i(0); i < numInodes; i++) {                // For each inode
-            file.read(reinterpret_cast<char*>(&newInode), INODE_SIZE);
-            for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
-                if (newInode.DIRECT_BLOCKS[j] > usedBlocks) // If more blocks are used
-                    usedBlocks = newInode.DIRECT_BLOCKS[j]; // Update the used blocks counter
-        }
+        char usedBlocks = maxDirectBlock(file, layout);  // Last block index used by any inode
 
         int bitmapInt(0); 
         for (int i(0); i <= usedBlocks; i++) // For each used block
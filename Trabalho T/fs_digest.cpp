@@ -0,0 +1,51 @@
+/**
+ * Calcula o SHA-256 de várias imagens em paralelo, no mesmo formato de printSha256
+ */
+
+#include "sha256.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [-j threads] <file>... | -\n", program);
+    fprintf(stderr, "  -             read the list of files from stdin, one per line\n");
+    fprintf(stderr, "  -j threads    number of worker threads (default: one per core)\n");
+}
+
+int main(int argc, char **argv)
+{
+    int threads(0);
+    std::vector<std::string> paths;
+    for (int i(1); i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-") == 0) {
+            std::string line;
+            while (std::getline(std::cin, line))
+                if (!line.empty())
+                    paths.push_back(line);
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> hashes = printSha256Batch(paths, threads);
+    int failed(0);
+    for (size_t i(0); i < paths.size(); i++) {
+        if (hashes[i].empty()) {
+            fprintf(stderr, "%s: cannot read\n", paths[i].c_str());
+            failed++;
+            continue;
+        }
+        printf("%s  %s\n", hashes[i].c_str(), paths[i].c_str());
+    }
+    return failed > 0;
+}
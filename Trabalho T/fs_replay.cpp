@@ -0,0 +1,91 @@
+/**
+ * Reproduz um trace gravado com startTrace e mede vazão e latência das operações
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s <trace> [--paced] [--image <fsFileName>]\n", program);
+    fprintf(stderr, "  --paced         keep the recorded spacing between operations (default: as fast as possible)\n");
+    fprintf(stderr, "  --image <file>  replay against this image instead of the recorded one\n");
+}
+
+/**
+ * @brief Percentil (nearest-rank) de um vetor ordenado de latências
+ */
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static void printLatencies(const char *name, std::vector<double> &latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    printf("%-8s %8zu %10.1f %10.1f %10.1f %10.1f\n", name, latencies.size(),
+           percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99), latencies.back());
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bool paced(false);
+    std::string image;
+    for (int i(2); i < argc; i++) {
+        if (strcmp(argv[i], "--paced") == 0)
+            paced = true;
+        else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+            image = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<TRACE_RECORD> records;
+    if (!readTrace(argv[1], records)) {
+        fprintf(stderr, "%s: not a valid trace\n", argv[1]);
+        return 1;
+    }
+
+    std::map<unsigned char, std::vector<double>> latencies;   // Microseconds per operation type
+    std::vector<double> all;
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t firstStart = records.empty() ? 0 : records[0].start;
+    for (const TRACE_RECORD &record : records)                // Records are written as operations end: concurrent
+        firstStart = std::min(firstStart, record.start);     // ones may start before the first record
+    for (const TRACE_RECORD &record : records) {
+        if (paced)                                             // Wait for the recorded offset of this operation
+            std::this_thread::sleep_until(begin + std::chrono::nanoseconds(record.start - firstStart));
+
+        auto start = std::chrono::steady_clock::now();
+        replayRecord(record, image);
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        latencies[record.op].push_back(micros);
+        all.push_back(micros);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("%zu operations in %.3f s (%.1f ops/s)\n", records.size(), seconds, seconds > 0 ? records.size() / seconds : 0);
+    if (all.empty())
+        return 0;
+    printf("%-8s %8s %10s %10s %10s %10s\n", "op", "count", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    for (auto &entry : latencies)
+        printLatencies(traceOpName(entry.first), entry.second);
+    printLatencies("all", all);
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * Utilitário de linha de comando para imagens do sistema de arquivos que simula EXT3
+ */
+
+#include "bulk.h"
+#include "merkle.h"
+#include "trim.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <command> [args]\n"
+              << "Commands:\n"
+              << "  trim <image>                   release the disk space of every free block\n"
+              << "  import-tree <image> <dir>      copy a host directory tree into the image root\n"
+              << "  import-tar <image> <tar|->     copy the entries of a tar archive into the image\n"
+              << "  export-tar <image> <tar|->     write the whole image tree as a tar archive\n"
+              << "  merkle <image> [leafSize]      print the Merkle root of the image\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "trim") == 0 && argc == 3) {
+        int ranges = trim(argv[2]);
+        if (ranges < 0) {
+            perror("trim");
+            return 1;
+        }
+        std::cout << ranges << " free range(s) punched\n";
+        return 0;
+    }
+
+    if (strcmp(argv[1], "import-tree") == 0 && argc == 4) {
+        int entries = importTree(argv[2], argv[3]);
+        if (entries < 0) {
+            std::cerr << "import-tree: failed\n";
+            return 1;
+        }
+        std::cout << entries << " entr(ies) imported\n";
+        return 0;
+    }
+
+    if (strcmp(argv[1], "import-tar") == 0 && argc == 4) {
+        std::ifstream file;
+        if (strcmp(argv[3], "-") != 0)
+            file.open(argv[3], std::ios::binary);
+        int entries = importTar(argv[2], strcmp(argv[3], "-") == 0 ? std::cin : file);
+        if (entries < 0) {
+            std::cerr << "import-tar: failed\n";
+            return 1;
+        }
+        std::cout << entries << " entr(ies) imported\n";
+        return 0;
+    }
+
+    if (strcmp(argv[1], "export-tar") == 0 && argc == 4) {
+        int tarFd = strcmp(argv[3], "-") == 0 ? STDOUT_FILENO : open(argv[3], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (tarFd < 0) {
+            perror("export-tar");
+            return 1;
+        }
+        int entries = exportTar(argv[2], tarFd);
+        if (tarFd != STDOUT_FILENO)
+            close(tarFd);
+        if (entries < 0) {
+            std::cerr << "export-tar: failed\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (strcmp(argv[1], "merkle") == 0 && (argc == 3 || argc == 4)) {
+        MERKLE_TREE tree;
+        size_t leafSize = argc == 4 ? strtoul(argv[3], NULL, 10) : MERKLE_LEAF_SIZE;
+        if (!buildMerkle(argv[2], tree, leafSize)) {
+            perror("merkle");
+            return 1;
+        }
+        std::cout << merkleRoot(tree) << "\n";
+        return 0;
+    }
+
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,373 @@
+/**
+ * Metadados de uma imagem do sistema de arquivos que simula EXT3 carregados em memória
+ */
+
+#include "image.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+/**
+ * @brief Lê o cabeçalho, o mapa de bits e o vetor de inodes de uma imagem
+ * @param fd descritor de arquivo aberto da imagem
+ * @param image metadados lidos
+ * @return true se a imagem foi lida
+ */
+bool loadImage(int fd, IMAGE &image)
+{
+    if (!readLayout(fd, image.layout))
+        return false;
+
+    image.bitmap.assign(image.layout.bitmapSize, 0);
+    if (pread(fd, image.bitmap.data(), image.layout.bitmapSize, HEADER_SIZE) != image.layout.bitmapSize)
+        return false;
+
+    image.inodes.assign(image.layout.numInodes, INODE{});
+    ssize_t inodeVectorSize = INODE_SIZE * image.layout.numInodes;  // Whole inode vector in one read
+    if (pread(fd, image.inodes.data(), inodeVectorSize, image.layout.inodeStart) != inodeVectorSize)
+        return false;
+
+    image.dirBlocks.clear();
+    image.dirtyBlocks.clear();
+    image.nextInode = ROOT_INODE + 1;
+    image.nextBlock = 0;
+    return true;
+}
+
+/**
+ * @brief Escreve de volta o mapa de bits, o vetor de inodes e os blocos de diretório alterados
+ * @param fd descritor de arquivo aberto (escrita) da imagem
+ * @param image metadados a serem escritos
+ * @return true se a imagem foi escrita
+ */
+bool flushImage(int fd, IMAGE &image)
+{
+    if (pwrite(fd, image.bitmap.data(), image.layout.bitmapSize, HEADER_SIZE) != image.layout.bitmapSize)
+        return false;
+
+    ssize_t inodeVectorSize = INODE_SIZE * image.layout.numInodes;
+    if (pwrite(fd, image.inodes.data(), inodeVectorSize, image.layout.inodeStart) != inodeVectorSize)
+        return false;
+
+    for (int block : image.dirtyBlocks) {                            // Each changed directory block once
+        const std::vector<unsigned char> &bytes = image.dirBlocks[block];
+        if (pwrite(fd, bytes.data(), bytes.size(), blockOffset(image.layout, block)) != (ssize_t) bytes.size())
+            return false;
+    }
+    image.dirtyBlocks.clear();
+    return true;
+}
+
+/**
+ * @brief Reserva um inode livre
+ * @return índice do inode ou -1 se não houver inode livre
+ */
+int allocInode(IMAGE &image)
+{
+    int numInodes = image.layout.numInodes;
+    for (int n(0); n < numInodes - 1; n++) {                         // Start at the cursor and wrap around, skipping the root
+        int i = 1 + (image.nextInode - 1 + n) % (numInodes - 1);
+        if (image.inodes[i].IS_USED == NOT_USED) {
+            memset(&image.inodes[i], 0, INODE_SIZE);
+            image.inodes[i].IS_USED = USED;
+            image.nextInode = i + 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Marca um bloco como usado no mapa de bits
+ */
+static void useBlock(IMAGE &image, int block)
+{
+    image.bitmap[block / BYTE_SIZE] |= (1 << (block % BYTE_SIZE));
+}
+
+/**
+ * @brief Marca um bloco como livre no mapa de bits
+ */
+void freeBlock(IMAGE &image, int block)
+{
+    image.bitmap[block / BYTE_SIZE] &= ~(1 << (block % BYTE_SIZE));
+    image.dirBlocks.erase(block);
+    image.dirtyBlocks.erase(block);
+}
+
+/**
+ * @brief Reserva count blocos livres, preferindo uma sequência contígua
+ * @return índices dos blocos ou vetor vazio se não houver blocos suficientes
+ */
+std::vector<int> allocBlocks(IMAGE &image, int count)
+{
+    int numBlocks = image.layout.numBlocks;
+    std::vector<int> blocks;
+    if (count <= 0)
+        return blocks;
+
+    // First fit for a contiguous run, starting at the cursor so consecutive allocations stay sequential
+    for (int n(0); n < numBlocks; n++) {
+        int start = (image.nextBlock + n) % numBlocks;
+        if (start + count > numBlocks)
+            continue;
+        int length(0);
+        while (length < count && !isBlockUsed(image.bitmap.data(), start + length))
+            length++;
+        if (length == count) {
+            for (int i(0); i < count; i++) {
+                useBlock(image, start + i);
+                blocks.push_back(start + i);
+            }
+            image.nextBlock = (start + count) % numBlocks;
+            return blocks;
+        }
+    }
+
+    // Fragmented image: take any free blocks
+    for (int i(0); i < numBlocks && (int) blocks.size() < count; i++)
+        if (!isBlockUsed(image.bitmap.data(), i))
+            blocks.push_back(i);
+    if ((int) blocks.size() < count)
+        return std::vector<int>();
+    for (int block : blocks)
+        useBlock(image, block);
+    return blocks;
+}
+
+/**
+ * @brief Blocos diretos usados por um inode
+ */
+std::vector<int> inodeBlocks(const IMAGE &image, int inode)
+{
+    std::vector<int> blocks;
+    const INODE &node = image.inodes[inode];
+    for (int j(0); j < DIRECT_BLOCKS_SIZE; j++)
+        if (node.DIRECT_BLOCKS[j] != 0 || (inode == ROOT_INODE && j == 0)) // Block 0 belongs to the root directory
+            blocks.push_back(node.DIRECT_BLOCKS[j]);
+    return blocks;
+}
+
+/**
+ * @brief Bytes de um bloco de diretório, lidos do disco na primeira vez
+ */
+static std::vector<unsigned char> &dirBlock(int fd, IMAGE &image, int block)
+{
+    auto it = image.dirBlocks.find(block);
+    if (it != image.dirBlocks.end())
+        return it->second;
+
+    std::vector<unsigned char> &bytes = image.dirBlocks[block];
+    bytes.assign(image.layout.blockSize, 0);
+    pread(fd, bytes.data(), bytes.size(), blockOffset(image.layout, block));
+    return bytes;
+}
+
+/**
+ * @brief Índices dos inodes contidos em um diretório
+ * @param fd descritor de arquivo aberto da imagem
+ */
+std::vector<int> dirEntries(int fd, IMAGE &image, int dir)
+{
+    std::vector<int> entries;
+    std::vector<int> blocks = inodeBlocks(image, dir);
+    int size = static_cast<unsigned char>(image.inodes[dir].SIZE);
+    int blockSize = image.layout.blockSize;
+    for (int k(0); k < size && k / blockSize < (int) blocks.size(); k++)  // Entries are packed one byte each
+        entries.push_back(dirBlock(fd, image, blocks[k / blockSize])[k % blockSize]);
+    return entries;
+}
+
+/**
+ * @brief Nome de um inode como string
+ */
+std::string inodeName(const IMAGE &image, int inode)
+{
+    const char *name = image.inodes[inode].NAME;
+    return std::string(name, strnlen(name, NAME_SIZE));
+}
+
+/**
+ * @brief Procura um nome dentro de um diretório
+ * @return índice do inode ou -1 se o nome não existir
+ */
+int findEntry(int fd, IMAGE &image, int dir, const std::string &name)
+{
+    for (int entry : dirEntries(fd, image, dir))
+        if (entry < image.layout.numInodes && image.inodes[entry].IS_USED == USED && inodeName(image, entry) == name)
+            return entry;
+    return -1;
+}
+
+/**
+ * @brief Resolve um caminho completo (ex.: "/dir/arquivo.txt")
+ * @return índice do inode ou -1 se o caminho não existir
+ */
+int lookupPath(int fd, IMAGE &image, const std::string &path)
+{
+    int inode(ROOT_INODE);
+    size_t start(0);
+    while (start < path.size() && inode >= 0) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos)
+            end = path.size();
+        if (end > start) {                                            // Skip empty components ("//", leading "/")
+            if (image.inodes[inode].IS_DIR != ISDIR)
+                return -1;
+            inode = findEntry(fd, image, inode, path.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return inode;
+}
+
+/**
+ * @brief Acrescenta uma entrada ao final de um diretório, reservando um novo bloco se necessário
+ * @return true se havia espaço no diretório
+ */
+static bool appendDirEntry(int fd, IMAGE &image, int dir, int child)
+{
+    INODE &node = image.inodes[dir];
+    int size = static_cast<unsigned char>(node.SIZE);
+    int blockSize = image.layout.blockSize;
+    int slot = size / blockSize;
+    if (slot >= DIRECT_BLOCKS_SIZE || size >= 255)
+        return false;
+
+    std::vector<int> blocks = inodeBlocks(image, dir);
+    if (slot >= (int) blocks.size()) {                                // Directory is full: grow it by one block
+        std::vector<int> block = allocBlocks(image, 1);
+        if (block.empty())
+            return false;
+        node.DIRECT_BLOCKS[slot] = block[0];
+        dirBlock(fd, image, block[0]).assign(blockSize, 0);
+        blocks.push_back(block[0]);
+    }
+
+    dirBlock(fd, image, blocks[slot])[size % blockSize] = child;
+    image.dirtyBlocks.insert(blocks[slot]);
+    node.SIZE = static_cast<char>(size + 1);
+    return true;
+}
+
+/**
+ * @brief Retira uma entrada de um diretório, deslocando as entradas seguintes uma posição para trás
+ * @return false se a entrada não pertence ao diretório
+ */
+static bool removeDirEntry(int fd, IMAGE &image, int dir, int child)
+{
+    std::vector<int> entries = dirEntries(fd, image, dir);
+    auto it = std::find(entries.begin(), entries.end(), child);
+    if (it == entries.end())
+        return false;
+
+    std::vector<int> blocks = inodeBlocks(image, dir);
+    int blockSize = image.layout.blockSize;
+    for (int k = it - entries.begin(); k + 1 < (int) entries.size(); k++) { // The stale last byte is left as is
+        int block = blocks[k / blockSize];
+        dirBlock(fd, image, block)[k % blockSize] = entries[k + 1];
+        image.dirtyBlocks.insert(block);
+    }
+    image.inodes[dir].SIZE = static_cast<char>(entries.size() - 1);
+    return true;
+}
+
+/**
+ * @brief Remove um arquivo ou diretório e toda a sua subárvore. A subárvore é coletada em uma única
+ * travessia e os inodes e blocos são liberados apenas em memória; um flushImage grava tudo de uma vez.
+ * @param fd descritor de arquivo aberto da imagem
+ * @param parent inode do diretório que contém a entrada
+ * @param inode inode a ser removido (não pode ser a raiz)
+ * @param freedBlocks recebe os blocos liberados
+ * @return false se a entrada não pertence ao diretório
+ */
+bool removeTree(int fd, IMAGE &image, int parent, int inode, std::vector<int> &freedBlocks)
+{
+    if (inode == ROOT_INODE || !removeDirEntry(fd, image, parent, inode))
+        return false;
+
+    std::vector<bool> visited(image.layout.numInodes, false);        // Guards against corrupted images with cycles
+    std::vector<int> pending(1, inode);
+    visited[inode] = true;
+    while (!pending.empty()) {
+        int current = pending.back();
+        pending.pop_back();
+        if (image.inodes[current].IS_DIR == ISDIR)
+            for (int child : dirEntries(fd, image, current))
+                if (child != ROOT_INODE && child < image.layout.numInodes && !visited[child] &&
+                    image.inodes[child].IS_USED == USED) {
+                    visited[child] = true;
+                    pending.push_back(child);
+                }
+
+        for (int block : inodeBlocks(image, current))                 // Bitmap bits are cleared in memory only
+            if (block != 0 && block < image.layout.numBlocks) {       // Block 0 belongs to the root directory
+                freeBlock(image, block);
+                freedBlocks.push_back(block);
+            }
+        image.inodes[current].IS_USED = NOT_USED;                     // Only IS_USED changes, as in the original format
+    }
+    return true;
+}
+
+/**
+ * @brief Cria um arquivo ou diretório dentro de um diretório, reservando seus blocos
+ * @param fd descritor de arquivo aberto da imagem
+ * @param parent inode do diretório pai
+ * @param name nome da nova entrada (até NAME_SIZE caracteres)
+ * @param isDir true para diretório
+ * @param size tamanho em bytes do conteúdo (arquivos)
+ * @return índice do novo inode ou -1 se não houver espaço
+ */
+int createEntry(int fd, IMAGE &image, int parent, const std::string &name, bool isDir, int size)
+{
+    int blockSize = image.layout.blockSize;
+    int numBlocks = isDir ? 1 : (size + blockSize - 1) / blockSize;  // Directories start with one block
+    if (name.empty() || name.size() > NAME_SIZE || numBlocks > DIRECT_BLOCKS_SIZE || size > 255)
+        return -1;
+    if (image.inodes[parent].IS_DIR != ISDIR || findEntry(fd, image, parent, name) >= 0)
+        return -1;
+
+    int inode = allocInode(image);
+    if (inode < 0)
+        return -1;
+
+    std::vector<int> blocks = allocBlocks(image, numBlocks);
+    if ((int) blocks.size() != numBlocks || !appendDirEntry(fd, image, parent, inode)) {
+        for (int block : blocks)                                      // Roll back the reservations
+            freeBlock(image, block);
+        image.inodes[inode].IS_USED = NOT_USED;
+        return -1;
+    }
+
+    INODE &node = image.inodes[inode];
+    node.IS_DIR = isDir ? ISDIR : IS_FILE;
+    strncpy(node.NAME, name.c_str(), NAME_SIZE);
+    node.SIZE = static_cast<char>(isDir ? 0 : size);
+    for (int j(0); j < numBlocks; j++)
+        node.DIRECT_BLOCKS[j] = blocks[j];
+
+    if (isDir) {                                                      // Empty directory block
+        dirBlock(fd, image, blocks[0]).assign(blockSize, 0);
+        image.dirtyBlocks.insert(blocks[0]);
+    }
+    return inode;
+}
+
+/**
+ * @brief Lê todo o conteúdo de um arquivo
+ * @param fd descritor de arquivo aberto da imagem
+ */
+std::string readFileData(int fd, const IMAGE &image, int inode)
+{
+    int size = static_cast<unsigned char>(image.inodes[inode].SIZE);
+    std::string data(size, 0);
+    std::vector<int> blocks = inodeBlocks(image, inode);
+    int blockSize = image.layout.blockSize;
+    for (int k(0), done(0); k < (int) blocks.size() && done < size; k++) {
+        int length = std::min(blockSize, size - done);
+        pread(fd, &data[done], length, blockOffset(image.layout, blocks[k]));
+        done += length;
+    }
+    return data;
+}
@@ -0,0 +1,112 @@
+/**
+ * Metadados de uma imagem do sistema de arquivos que simula EXT3 carregados em memória
+ */
+
+#ifndef image_h
+#define image_h
+#include "layout.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef struct {
+    LAYOUT layout;                                         // geometria da imagem
+    std::vector<unsigned char> bitmap;                     // mapa de bits dos blocos
+    std::vector<INODE> inodes;                             // vetor de inodes
+    std::map<int, std::vector<unsigned char>> dirBlocks;   // blocos de diretório já lidos
+    std::set<int> dirtyBlocks;                             // blocos de diretório alterados
+    int nextInode;                                         // cursor de alocação de inodes
+    int nextBlock;                                         // cursor de alocação de blocos
+} IMAGE;
+
+/**
+ * @brief Lê o cabeçalho, o mapa de bits e o vetor de inodes de uma imagem
+ * @param fd descritor de arquivo aberto da imagem
+ * @param image metadados lidos
+ * @return true se a imagem foi lida
+ */
+bool loadImage(int fd, IMAGE &image);
+
+/**
+ * @brief Escreve de volta o mapa de bits, o vetor de inodes e os blocos de diretório alterados
+ * @param fd descritor de arquivo aberto (escrita) da imagem
+ * @param image metadados a serem escritos
+ * @return true se a imagem foi escrita
+ */
+bool flushImage(int fd, IMAGE &image);
+
+/**
+ * @brief Reserva um inode livre
+ * @return índice do inode ou -1 se não houver inode livre
+ */
+int allocInode(IMAGE &image);
+
+/**
+ * @brief Reserva count blocos livres, preferindo uma sequência contígua
+ * @return índices dos blocos ou vetor vazio se não houver blocos suficientes
+ */
+std::vector<int> allocBlocks(IMAGE &image, int count);
+
+/**
+ * @brief Marca um bloco como livre no mapa de bits
+ */
+void freeBlock(IMAGE &image, int block);
+
+/**
+ * @brief Blocos diretos usados por um inode
+ */
+std::vector<int> inodeBlocks(const IMAGE &image, int inode);
+
+/**
+ * @brief Índices dos inodes contidos em um diretório
+ * @param fd descritor de arquivo aberto da imagem
+ */
+std::vector<int> dirEntries(int fd, IMAGE &image, int dir);
+
+/**
+ * @brief Procura um nome dentro de um diretório
+ * @return índice do inode ou -1 se o nome não existir
+ */
+int findEntry(int fd, IMAGE &image, int dir, const std::string &name);
+
+/**
+ * @brief Resolve um caminho completo (ex.: "/dir/arquivo.txt")
+ * @return índice do inode ou -1 se o caminho não existir
+ */
+int lookupPath(int fd, IMAGE &image, const std::string &path);
+
+/**
+ * @brief Cria um arquivo ou diretório dentro de um diretório, reservando seus blocos
+ * @param fd descritor de arquivo aberto da imagem
+ * @param parent inode do diretório pai
+ * @param name nome da nova entrada (até NAME_SIZE caracteres)
+ * @param isDir true para diretório
+ * @param size tamanho em bytes do conteúdo (arquivos)
+ * @return índice do novo inode ou -1 se não houver espaço
+ */
+int createEntry(int fd, IMAGE &image, int parent, const std::string &name, bool isDir, int size);
+
+/**
+ * @brief Remove um arquivo ou diretório e toda a sua subárvore. A subárvore é coletada em uma única
+ * travessia e os inodes e blocos são liberados apenas em memória; um flushImage grava tudo de uma vez.
+ * @param fd descritor de arquivo aberto da imagem
+ * @param parent inode do diretório que contém a entrada
+ * @param inode inode a ser removido (não pode ser a raiz)
+ * @param freedBlocks recebe os blocos liberados
+ * @return false se a entrada não pertence ao diretório
+ */
+bool removeTree(int fd, IMAGE &image, int parent, int inode, std::vector<int> &freedBlocks);
+
+/**
+ * @brief Nome de um inode como string
+ */
+std::string inodeName(const IMAGE &image, int inode);
+
+/**
+ * @brief Lê todo o conteúdo de um arquivo
+ * @param fd descritor de arquivo aberto da imagem
+ */
+std::string readFileData(int fd, const IMAGE &image, int inode);
+
+#endif /* image_h */
@@ -0,0 +1,22 @@
+/**
+ * Leitura da geometria de uma imagem do sistema de arquivos que simula EXT3
+ */
+
+#include "layout.h"
+#include <unistd.h>
+
+/**
+ * @brief Lê o cabeçalho de uma imagem e calcula sua geometria
+ * @param fd descritor de arquivo aberto da imagem
+ * @param layout geometria lida
+ * @return true se o cabeçalho foi lido
+ */
+bool readLayout(int fd, LAYOUT &layout)
+{
+    unsigned char header[HEADER_SIZE];                      // Header of the image
+    if (pread(fd, header, HEADER_SIZE, 0) != HEADER_SIZE)   // Read the header without moving the file offset
+        return false;
+
+    layout = makeLayout(header[0], header[1], header[2]);   // Block size, number of blocks and number of inodes
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * Geometria de uma imagem do sistema de arquivos que simula EXT3
+ */
+
+#ifndef layout_h
+#define layout_h
+#include "fs.h"
+#include <cstddef>
+
+#define HEADER_SIZE 3
+#define INODE_SIZE 22
+#define BYTE_SIZE 8
+#define USED 1
+#define NOT_USED 0
+#define ISDIR 1
+#define IS_FILE 0
+#define NAME_SIZE 10
+#define DIRECT_BLOCKS_SIZE 3
+#define ROOT_INODE 0
+
+static constexpr int INODE_NAME_OFFSET = offsetof(INODE, NAME);            // Offset of NAME inside an inode
+static constexpr int INODE_SIZE_OFFSET = offsetof(INODE, SIZE);            // Offset of SIZE inside an inode
+static constexpr int INODE_DIRECT_OFFSET = offsetof(INODE, DIRECT_BLOCKS); // Offset of DIRECT_BLOCKS inside an inode
+
+typedef struct {
+    int blockSize;  // tamanho em bytes do bloco
+    int numBlocks;  // quantidade de blocos
+    int numInodes;  // quantidade de inodes
+    int bitmapSize; // tamanho em bytes do mapa de bits
+    int inodeStart; // offset do primeiro inode
+    int blockStart; // offset do primeiro bloco
+    int imageSize;  // tamanho total da imagem em bytes
+} LAYOUT;
+
+/**
+ * @brief Calcula a geometria de uma imagem a partir dos valores do cabeçalho
+ * @param blockSize tamanho em bytes do bloco
+ * @param numBlocks quantidade de blocos
+ * @param numInodes quantidade de inodes
+ */
+inline LAYOUT makeLayout(int blockSize, int numBlocks, int numInodes)
+{
+    LAYOUT layout;
+    layout.blockSize = blockSize;
+    layout.numBlocks = numBlocks;
+    layout.numInodes = numInodes;
+    layout.bitmapSize = (numBlocks + BYTE_SIZE - 1) / BYTE_SIZE;           // One bit per block, rounded up
+    layout.inodeStart = HEADER_SIZE + layout.bitmapSize;                   // Inodes come right after the bitmap
+    layout.blockStart = layout.inodeStart + INODE_SIZE * numInodes + 1;    // One byte (root index) before the blocks
+    layout.imageSize = layout.blockStart + blockSize * numBlocks;
+    return layout;
+}
+
+/**
+ * @brief Lê o cabeçalho de uma imagem e calcula sua geometria
+ * @param fd descritor de arquivo aberto da imagem
+ * @param layout geometria lida
+ * @return true se o cabeçalho foi lido
+ */
+bool readLayout(int fd, LAYOUT &layout);
+
+/**
+ * @brief Offset do inode de índice inode dentro da imagem
+ */
+inline int inodeOffset(const LAYOUT &layout, int inode)
+{
+    return layout.inodeStart + inode * INODE_SIZE;
+}
+
+/**
+ * @brief Offset do bloco de índice block dentro da imagem
+ */
+inline int blockOffset(const LAYOUT &layout, int block)
+{
+    return layout.blockStart + block * layout.blockSize;
+}
+
+/**
+ * @brief Indica se o bloco de índice block está marcado como usado no mapa de bits
+ */
+inline bool isBlockUsed(const unsigned char *bitmap, int block)
+{
+    return bitmap[block / BYTE_SIZE] & (1 << (block % BYTE_SIZE));
+}
+
+/**
+ * Geometria conhecida em tempo de compilação. Tem os mesmos campos de LAYOUT, de modo que o mesmo
+ * código genérico (template) aceita os dois; com FixedLayout todos os offsets são constantes e os
+ * laços sobre inodes e blocos têm passo e quantidade de iterações fixos.
+ */
+template <int BLOCK_SIZE, int NUM_BLOCKS, int NUM_INODES>
+struct FixedLayout {
+    static constexpr int blockSize = BLOCK_SIZE;
+    static constexpr int numBlocks = NUM_BLOCKS;
+    static constexpr int numInodes = NUM_INODES;
+    static constexpr int bitmapSize = (NUM_BLOCKS + BYTE_SIZE - 1) / BYTE_SIZE;
+    static constexpr int inodeStart = HEADER_SIZE + bitmapSize;
+    static constexpr int blockStart = inodeStart + INODE_SIZE * NUM_INODES + 1;
+    static constexpr int imageSize = blockStart + BLOCK_SIZE * NUM_BLOCKS;
+};
+
+template <int BLOCK_SIZE, int NUM_BLOCKS, int NUM_INODES>
+constexpr int inodeOffset(const FixedLayout<BLOCK_SIZE, NUM_BLOCKS, NUM_INODES> &, int inode)
+{
+    return FixedLayout<BLOCK_SIZE, NUM_BLOCKS, NUM_INODES>::inodeStart + inode * INODE_SIZE;
+}
+
+template <int BLOCK_SIZE, int NUM_BLOCKS, int NUM_INODES>
+constexpr int blockOffset(const FixedLayout<BLOCK_SIZE, NUM_BLOCKS, NUM_INODES> &, int block)
+{
+    return FixedLayout<BLOCK_SIZE, NUM_BLOCKS, NUM_INODES>::blockStart + block * BLOCK_SIZE;
+}
+
+/**
+ * @brief Chama visitor com a especialização FixedLayout correspondente à geometria, se ela for uma
+ * das geometrias comuns, ou com o próprio LAYOUT (caminho dinâmico) caso contrário
+ * @param layout geometria lida do cabeçalho
+ * @param visitor função genérica (ex.: [&](const auto &l) {...}) com o mesmo tipo de retorno para todas as geometrias
+ */
+template <typename Visitor>
+auto withLayout(const LAYOUT &layout, Visitor visitor)
+{
+#define FIXED_LAYOUT(B, N, I) \
+    if (layout.blockSize == B && layout.numBlocks == N && layout.numInodes == I) \
+        return visitor(FixedLayout<B, N, I>());
+
+    FIXED_LAYOUT(1, 10, 10)
+    FIXED_LAYOUT(2, 8, 5)
+    FIXED_LAYOUT(2, 8, 6)
+    FIXED_LAYOUT(2, 10, 5)
+    FIXED_LAYOUT(4, 32, 16)
+    FIXED_LAYOUT(8, 64, 32)
+    FIXED_LAYOUT(16, 128, 64)
+#undef FIXED_LAYOUT
+
+    return visitor(layout);
+}
+
+#endif /* layout_h */
@@ -1,9 +1,20 @@
 #include "gtest/gtest.h"
 #include "fs.h"
 #include "sha256.h"
+#include "trim.h"
+#include "bulk.h"
+#include "image.h"
+#include "trace.h"
+#include "merkle.h"
+#include "session.h"
+#include "shared.h"
 
 #include <fstream>
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 void duplicate(std::string fsrc, std::string fdest)
 {
@@ -13,6 +24,15 @@ void duplicate(std::string fsrc, std::string fdest)
     dst << src.rdbuf();
 }
 
+std::string readBytes(std::string path, int offset, int count)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string bytes(count, 0);
+    file.seekg(offset);
+    file.read(&bytes[0], count);
+    return bytes;
+}
+
 
 TEST(FsTest, init021005){
     initFs("fs2-10-5.bin.solucao", 2, 10, 5);
@@ -94,6 +114,257 @@ TEST(FsTest, case12){
     ASSERT_EQ(printSha256("fs-case12.bin.solucao"),std::string("BC:2B:05:C8:8B:DF:02:41:3B:E3:86:8E:4C:CC:C1:FF:63:87:F9:A5:24:15:16:49:83:88:F0:75:18:D1:1B:BE"));
     }
 
+TEST(FsTest, punchOnRemove){
+    duplicate("fs-case7.bin", "fs-punch.bin.solucao");
+
+    setPunchOnFree(true);
+    remove("fs-punch.bin.solucao", "/dec7556/t2.txt");
+    setPunchOnFree(false);
+
+    ASSERT_EQ(readBytes("fs-punch.bin.solucao", 145, 4), std::string(4, 0));     // Blocks 4 and 5 held "fghi"
+    ASSERT_EQ(readBytes("fs-punch.bin.solucao", 139, 3), std::string("abc"));    // teste.txt is untouched
+}
+
+TEST(FsTest, trim){
+    duplicate("fs-case5.bin", "fs-trim.bin.solucao");
+    {
+        std::fstream file("fs-trim.bin.solucao", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(147);                                                         // Free block 5
+        file.write("zz", 2);
+    }
+
+    ASSERT_EQ(trim("fs-trim.bin.solucao"), 1);                                  // Free blocks 3..7 form one range
+    ASSERT_EQ(readBytes("fs-trim.bin.solucao", 147, 2), std::string(2, 0));
+    ASSERT_EQ(printSha256("fs-trim.bin.solucao"), printSha256("fs-case5.bin"));
+}
+
+TEST(FsTest, importExport){
+    mkdir("bulk-src.solucao", 0755);
+    mkdir("bulk-src.solucao/sub", 0755);
+    mkdir("bulk-src.solucao/sub/empty", 0755);
+    std::ofstream("bulk-src.solucao/a.txt") << "hello";
+    std::ofstream("bulk-src.solucao/sub/b.txt") << "xyz";
+
+    initFs("fs-bulk.bin.solucao", 4, 32, 16);
+    ASSERT_EQ(importTree("fs-bulk.bin.solucao", "bulk-src.solucao"), 4);
+
+    int fd = open("fs-bulk.bin.solucao", O_RDONLY);
+    IMAGE image;
+    ASSERT_TRUE(loadImage(fd, image));
+    int inode = lookupPath(fd, image, "/sub/b.txt");
+    ASSERT_GE(inode, 0);
+    ASSERT_EQ(readFileData(fd, image, inode), std::string("xyz"));
+    ASSERT_EQ(readFileData(fd, image, lookupPath(fd, image, "/a.txt")), std::string("hello"));
+    ASSERT_EQ(lookupPath(fd, image, "/sub/missing"), -1);
+    close(fd);
+
+    int tarFd = open("fs-bulk.tar.solucao", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_EQ(exportTar("fs-bulk.bin.solucao", tarFd), 4);
+    close(tarFd);
+
+    initFs("fs-bulk2.bin.solucao", 4, 32, 16);
+    std::ifstream tar("fs-bulk.tar.solucao", std::ios::binary);
+    ASSERT_EQ(importTar("fs-bulk2.bin.solucao", tar), 4);
+    ASSERT_EQ(printSha256("fs-bulk2.bin.solucao"), printSha256("fs-bulk.bin.solucao"));
+}
+
+TEST(FsTest, traceReplay){
+    duplicate("fs-case4.bin", "fs-trace-a.bin.solucao");
+    ASSERT_TRUE(startTrace("fs-trace.solucao"));
+    addFile("fs-trace-a.bin.solucao", "/teste.txt", "abc");
+    stopTrace();
+    addDir("fs-trace-a.bin.solucao", "/untraced");
+
+    std::vector<TRACE_RECORD> records;
+    ASSERT_TRUE(readTrace("fs-trace.solucao", records));
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(records[0].op, TRACE_ADD_FILE);
+    ASSERT_EQ(records[0].strings, std::vector<std::string>({"fs-trace-a.bin.solucao", "/teste.txt", "abc"}));
+
+    duplicate("fs-case4.bin", "fs-trace-b.bin.solucao");
+    replayRecord(records[0], "fs-trace-b.bin.solucao");
+    ASSERT_EQ(printSha256("fs-trace-b.bin.solucao"),std::string("AA:29:B7:CF:09:B6:32:0E:6B:20:51:ED:FD:8E:40:FB:B0:A8:71:FA:8A:22:0A:06:F4:E1:E4:69:0A:C6:B2:77"));
+}
+
+TEST(FsTest, fixedLayout){
+    typedef FixedLayout<2, 8, 6> Layout;
+    static_assert(Layout::blockStart == 137, "2/8/6 images keep their blocks at byte 137");
+    static_assert(blockOffset(Layout(), 4) == 145, "block 4 of a 2/8/6 image");
+
+    typedef FixedLayout<4, 32, 16> Layout4;
+    LAYOUT dynamic = makeLayout(4, 32, 16);
+    ASSERT_EQ(Layout4::inodeStart, dynamic.inodeStart);
+    ASSERT_EQ(Layout4::imageSize, dynamic.imageSize);
+
+    auto isFixed = [](const auto &l) { return !std::is_same<std::decay_t<decltype(l)>, LAYOUT>::value; };
+    auto secondInode = [](const auto &l) { return inodeOffset(l, 2); };
+    ASSERT_TRUE(withLayout(makeLayout(2, 8, 6), isFixed));
+    ASSERT_FALSE(withLayout(makeLayout(3, 9, 7), isFixed));
+    ASSERT_EQ(withLayout(makeLayout(2, 8, 6), secondInode), 4 + 2 * INODE_SIZE);
+    ASSERT_EQ(withLayout(makeLayout(3, 9, 7), secondInode), 5 + 2 * INODE_SIZE);
+}
+
+TEST(FsTest, merkle){
+    duplicate("fs-case6.bin", "fs-merkle.bin.solucao");
+
+    MERKLE_TREE tree;
+    ASSERT_TRUE(buildMerkle("fs-merkle.bin.solucao", tree, 16));
+    ASSERT_EQ(tree.levels[0].size(), 10u);                                          // 153 bytes in 16-byte leaves
+    std::string before = merkleRoot(tree);
+
+    MERKLE_TREE single;
+    ASSERT_TRUE(buildMerkle("fs-merkle.bin.solucao", single, 16, 1));
+    ASSERT_EQ(merkleRoot(single), before);                                          // Same root with one thread
+
+    addFile("fs-merkle.bin.solucao", "/dec7556/t2.txt", "fghi");
+    ASSERT_TRUE(updateMerkle("fs-merkle.bin.solucao", tree, 0, 153));
+    MERKLE_TREE rebuilt;
+    ASSERT_TRUE(buildMerkle("fs-merkle.bin.solucao", rebuilt, 16));
+    ASSERT_NE(merkleRoot(tree), before);
+    ASSERT_EQ(merkleRoot(tree), merkleRoot(rebuilt));
+
+    {
+        std::fstream file("fs-merkle.bin.solucao", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(150);                                                            // Last (partial) leaf only
+        file.put('x');
+    }
+    ASSERT_TRUE(updateMerkle("fs-merkle.bin.solucao", tree, 150, 1));
+    ASSERT_TRUE(buildMerkle("fs-merkle.bin.solucao", rebuilt, 16));
+    ASSERT_EQ(merkleRoot(tree), merkleRoot(rebuilt));
+}
+
+TEST(FsTest, sha256Batch){
+    std::vector<std::string> paths({"fs-case4.bin", "fs-case5.bin", "missing.bin", "fs-case6.bin", "fs-case12.bin"});
+    std::vector<std::string> hashes = printSha256Batch(paths, 3);
+    ASSERT_EQ(hashes.size(), paths.size());
+    for (size_t i(0); i < paths.size(); i++) {
+        if (paths[i] != "missing.bin") {
+            ASSERT_EQ(hashes[i], printSha256(paths[i].c_str()));
+        }
+    }
+    ASSERT_EQ(hashes[2], std::string(""));
+}
+
+TEST(FsTest, delayedAllocation){
+    initFs("fs-session.bin.solucao", 4, 32, 16);
+    std::string empty = printSha256("fs-session.bin.solucao");
+
+    SESSION session;
+    ASSERT_TRUE(openSession("fs-session.bin.solucao", session));
+    ASSERT_TRUE(sessionAddDir(session, "/d"));
+    ASSERT_TRUE(sessionAddFile(session, "/a.txt", "12345"));
+    ASSERT_TRUE(sessionAddFile(session, "/d/b.txt", "xy"));
+    ASSERT_TRUE(sessionAppend(session, "/a.txt", "678"));
+    ASSERT_FALSE(sessionAddFile(session, "/nodir/c.txt", "z"));
+    ASSERT_EQ(printSha256("fs-session.bin.solucao"), empty);                   // Nothing written before the flush
+
+    ASSERT_TRUE(closeSession(session));
+
+    int fd = open("fs-session.bin.solucao", O_RDONLY);
+    IMAGE image;
+    ASSERT_TRUE(loadImage(fd, image));
+    int a = lookupPath(fd, image, "/a.txt");
+    int b = lookupPath(fd, image, "/d/b.txt");
+    ASSERT_EQ(readFileData(fd, image, a), std::string("12345678"));
+    ASSERT_EQ(readFileData(fd, image, b), std::string("xy"));
+    ASSERT_EQ(image.inodes[a].DIRECT_BLOCKS[1], image.inodes[a].DIRECT_BLOCKS[0] + 1);  // One contiguous run
+    ASSERT_EQ(image.inodes[b].DIRECT_BLOCKS[0], image.inodes[a].DIRECT_BLOCKS[1] + 1);
+    close(fd);
+
+    ASSERT_TRUE(openSession("fs-session.bin.solucao", session, 4));           // Tiny limit: every add flushes
+    ASSERT_TRUE(sessionAppend(session, "/d/b.txt", "zzzzz"));
+    ASSERT_TRUE(session.pending.empty());
+    ASSERT_TRUE(closeSession(session));
+
+    fd = open("fs-session.bin.solucao", O_RDONLY);
+    ASSERT_TRUE(loadImage(fd, image));
+    ASSERT_EQ(readFileData(fd, image, lookupPath(fd, image, "/d/b.txt")), std::string("xyzzzzz"));
+    close(fd);
+}
+
+TEST(FsTest, recursiveRemove){
+    initFs("fs-rmtree.bin.solucao", 4, 32, 16);
+    SESSION session;
+    ASSERT_TRUE(openSession("fs-rmtree.bin.solucao", session));
+    ASSERT_TRUE(sessionAddFile(session, "/keep.txt", "kk"));
+    ASSERT_TRUE(sessionAddDir(session, "/d"));
+    ASSERT_TRUE(sessionAddDir(session, "/d/e"));
+    ASSERT_TRUE(sessionAddFile(session, "/d/a.txt", "123456"));
+    ASSERT_TRUE(sessionAddFile(session, "/d/e/b.txt", "xyz"));
+    ASSERT_TRUE(closeSession(session));
+
+    remove("fs-rmtree.bin.solucao", "/d");
+
+    int fd = open("fs-rmtree.bin.solucao", O_RDONLY);
+    IMAGE image;
+    ASSERT_TRUE(loadImage(fd, image));
+    ASSERT_EQ(dirEntries(fd, image, ROOT_INODE), std::vector<int>(1, lookupPath(fd, image, "/keep.txt")));
+    int used(0);
+    for (const INODE &inode : image.inodes)
+        used += inode.IS_USED == USED;
+    ASSERT_EQ(used, 2);                                                        // Root and keep.txt: no leaked children
+    int usedBlocks(0);
+    for (int block(0); block < image.layout.numBlocks; block++)
+        usedBlocks += isBlockUsed(image.bitmap.data(), block);
+    ASSERT_EQ(usedBlocks, 2);                                                  // Root block and keep.txt's block
+    ASSERT_EQ(readFileData(fd, image, lookupPath(fd, image, "/keep.txt")), std::string("kk"));
+    close(fd);
+}
+
+TEST(FsTest, sharedImage){
+    initFs("fs-shared.bin.solucao", 4, 32, 16);
+    unlink("fs-shared.bin.solucao.lock");
+
+    pid_t crashed = fork();                                                     // Dies holding the lock
+    if (crashed == 0) {
+        SHARED_IMAGE shared;
+        if (!openSharedImage("fs-shared.bin.solucao", shared))
+            _exit(1);
+        pthread_mutex_lock(&shared.lock->mutex);
+        _exit(0);
+    }
+    waitpid(crashed, NULL, 0);
+
+    std::vector<pid_t> writers;
+    for (int w(0); w < 3; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            SHARED_IMAGE shared;
+            bool ok = openSharedImage("fs-shared.bin.solucao", shared);
+            for (int f(0); ok && f < 3; f++)
+                ok = sharedAddFile(shared, "/w" + std::to_string(w) + std::to_string(f), std::string(5, 'a' + w));
+            closeSharedImage(shared);
+            _exit(ok ? 0 : 1);
+        }
+        writers.push_back(pid);
+    }
+    for (pid_t pid : writers) {
+        int status;
+        waitpid(pid, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    SHARED_IMAGE shared;
+    ASSERT_TRUE(openSharedImage("fs-shared.bin.solucao", shared));
+    ASSERT_TRUE(sharedAddDir(shared, "/d"));
+    ASSERT_EQ(shared.lock->recoveries, 1u);
+    ASSERT_EQ(shared.lock->generation, 10u);
+    closeSharedImage(shared);
+
+    int fd = open("fs-shared.bin.solucao", O_RDONLY);
+    IMAGE image;
+    ASSERT_TRUE(loadImage(fd, image));
+    ASSERT_EQ(dirEntries(fd, image, ROOT_INODE).size(), 10u);
+    for (int w(0); w < 3; w++)
+        for (int f(0); f < 3; f++)
+            ASSERT_EQ(readFileData(fd, image, lookupPath(fd, image, "/w" + std::to_string(w) + std::to_string(f))),
+                      std::string(5, 'a' + w));
+    close(fd);
+
+    ASSERT_EQ(truncate("fs-shared.bin.solucao", 100), 0);                      // Short image: error, not SIGBUS
+    ASSERT_FALSE(openSharedImage("fs-shared.bin.solucao", shared));
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
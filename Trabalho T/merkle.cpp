@@ -0,0 +1,209 @@
+/**
+ * Hash em árvore de Merkle de uma imagem
+ */
+
+#include "merkle.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#define LEAF_PREFIX 0x00  // Leaves and inner nodes are hashed with different prefixes (RFC 6962)
+#define NODE_PREFIX 0x01
+
+typedef struct {
+    int fd;
+    const unsigned char *data;
+    size_t size;
+} MAPPING;
+
+/**
+ * @brief Mapeia um arquivo inteiro para leitura
+ */
+static bool mapFile(const char *path, MAPPING &mapping)
+{
+    mapping.fd = open(path, O_RDONLY);
+    if (mapping.fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(mapping.fd, &st) < 0) {
+        close(mapping.fd);
+        return false;
+    }
+    mapping.size = st.st_size;
+    mapping.data = NULL;
+    if (mapping.size == 0)                                         // mmap rejects empty mappings
+        return true;
+
+    void *data = mmap(NULL, mapping.size, PROT_READ, MAP_PRIVATE, mapping.fd, 0);
+    if (data == MAP_FAILED) {
+        close(mapping.fd);
+        return false;
+    }
+    madvise(data, mapping.size, MADV_SEQUENTIAL);
+    mapping.data = static_cast<const unsigned char*>(data);
+    return true;
+}
+
+static void unmapFile(MAPPING &mapping)
+{
+    if (mapping.data != NULL)
+        munmap(const_cast<unsigned char*>(mapping.data), mapping.size);
+    close(mapping.fd);
+}
+
+/**
+ * @brief Calcula as folhas [first, last) com um contexto por thread
+ */
+static void hashLeaves(const MAPPING &mapping, MERKLE_TREE &tree, size_t first, size_t last, int threads)
+{
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t count = last - first;
+    threads = static_cast<int>(std::min<size_t>(threads, count));
+
+    auto worker = [&](size_t begin, size_t end) {
+        EVP_MD_CTX *ctx = EVP_MD_CTX_new();                         // Reused for every leaf of this worker
+        const unsigned char prefix = LEAF_PREFIX;
+        for (size_t i(begin); i < end; i++) {
+            size_t offset = i * tree.leafSize;
+            size_t size = offset < mapping.size ? std::min(tree.leafSize, mapping.size - offset) : 0;
+            EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+            EVP_DigestUpdate(ctx, &prefix, 1);
+            if (size > 0)
+                EVP_DigestUpdate(ctx, mapping.data + offset, size);
+            EVP_DigestFinal_ex(ctx, tree.levels[0][i].data(), NULL);
+        }
+        EVP_MD_CTX_free(ctx);
+    };
+
+    if (threads <= 1) {
+        worker(first, last);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    size_t chunk = (count + threads - 1) / threads;                 // Contiguous ranges keep reads sequential per thread
+    for (size_t begin(first); begin < last; begin += chunk)
+        pool.emplace_back(worker, begin, std::min(last, begin + chunk));
+    for (std::thread &thread : pool)
+        thread.join();
+}
+
+/**
+ * @brief Recalcula os nós internos acima das folhas alteradas
+ */
+static void hashParents(MERKLE_TREE &tree, std::set<size_t> dirty)
+{
+    EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+    const unsigned char prefix = NODE_PREFIX;
+    for (size_t level(1); level < tree.levels.size(); level++) {
+        const std::vector<DIGEST> &children = tree.levels[level - 1];
+        std::set<size_t> parents;
+        for (size_t child : dirty)
+            parents.insert(child / 2);
+
+        for (size_t i : parents) {
+            if (2 * i + 1 >= children.size()) {                    // Odd node is promoted unchanged
+                tree.levels[level][i] = children[2 * i];
+                continue;
+            }
+            EVP_DigestInit_ex(ctx, EVP_sha256(), NULL);
+            EVP_DigestUpdate(ctx, &prefix, 1);
+            EVP_DigestUpdate(ctx, children[2 * i].data(), SHA256_DIGEST_LENGTH);
+            EVP_DigestUpdate(ctx, children[2 * i + 1].data(), SHA256_DIGEST_LENGTH);
+            EVP_DigestFinal_ex(ctx, tree.levels[level][i].data(), NULL);
+        }
+        dirty = parents;
+    }
+    EVP_MD_CTX_free(ctx);
+}
+
+/**
+ * @brief Calcula a árvore de Merkle de um arquivo, com as folhas calculadas em paralelo sobre um mmap
+ * @param path caminho do arquivo
+ * @param tree árvore calculada
+ * @param leafSize tamanho em bytes de cada bloco folha
+ * @param threads quantidade de threads (0 = uma por núcleo)
+ * @return true se o arquivo foi lido
+ */
+bool buildMerkle(const char *path, MERKLE_TREE &tree, size_t leafSize, int threads)
+{
+    MAPPING mapping;
+    if (leafSize == 0 || !mapFile(path, mapping))
+        return false;
+
+    tree.leafSize = leafSize;
+    tree.fileSize = mapping.size;
+    tree.levels.clear();
+    size_t count = std::max<size_t>(1, (mapping.size + leafSize - 1) / leafSize); // An empty file still has one leaf
+    for (size_t width(count);; width = (width + 1) / 2) {
+        tree.levels.push_back(std::vector<DIGEST>(width));
+        if (width == 1)
+            break;
+    }
+
+    hashLeaves(mapping, tree, 0, count, threads);
+    unmapFile(mapping);
+
+    std::set<size_t> all;
+    for (size_t i(0); i < count; i++)
+        all.insert(i);
+    hashParents(tree, all);
+    return true;
+}
+
+/**
+ * @brief Recalcula apenas as folhas que cobrem o intervalo alterado e seus caminhos até a raiz.
+ * Se o tamanho do arquivo mudou, a árvore inteira é recalculada.
+ * @param path caminho do arquivo
+ * @param tree árvore calculada anteriormente com buildMerkle
+ * @param offset primeiro byte alterado
+ * @param length quantidade de bytes alterados
+ * @return true se o arquivo foi lido
+ */
+bool updateMerkle(const char *path, MERKLE_TREE &tree, size_t offset, size_t length)
+{
+    struct stat st;
+    if (stat(path, &st) < 0)
+        return false;
+    if (tree.levels.empty() || static_cast<size_t>(st.st_size) != tree.fileSize)
+        return buildMerkle(path, tree, tree.levels.empty() ? MERKLE_LEAF_SIZE : tree.leafSize);
+    if (length == 0 || offset >= tree.fileSize)
+        return true;
+
+    MAPPING mapping;
+    if (!mapFile(path, mapping))
+        return false;
+
+    size_t first = offset / tree.leafSize;
+    size_t last = std::min(tree.levels[0].size(), (std::min(offset + length, tree.fileSize) + tree.leafSize - 1) / tree.leafSize);
+    hashLeaves(mapping, tree, first, last, 1);
+    unmapFile(mapping);
+
+    std::set<size_t> dirty;
+    for (size_t i(first); i < last; i++)
+        dirty.insert(i);
+    hashParents(tree, dirty);
+    return true;
+}
+
+/**
+ * @brief Raiz da árvore no mesmo formato hexadecimal de printSha256 (ex.: "AB:CD:...")
+ */
+std::string merkleRoot(const MERKLE_TREE &tree)
+{
+    if (tree.levels.empty())
+        return std::string("");
+
+    char *hexOut = OPENSSL_buf2hexstr(tree.levels.back()[0].data(), SHA256_DIGEST_LENGTH);
+    std::string hexHash(hexOut);
+    OPENSSL_free(hexOut);
+    return hexHash;
+}
@@ -0,0 +1,53 @@
+/**
+ * Hash em árvore de Merkle de uma imagem: uma folha SHA-256 por bloco de leafSize bytes,
+ * combinadas par a par até a raiz. As folhas ficam guardadas para que, após uma alteração,
+ * apenas os blocos modificados e o caminho deles até a raiz sejam recalculados.
+ * printSha256 (sha256.h) continua disponível para o hash do arquivo inteiro.
+ */
+
+#ifndef merkle_h
+#define merkle_h
+
+#include <openssl/sha.h>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define MERKLE_LEAF_SIZE 4096
+
+typedef std::array<unsigned char, SHA256_DIGEST_LENGTH> DIGEST;
+
+typedef struct {
+    size_t leafSize;                        // tamanho em bytes de cada bloco folha
+    size_t fileSize;                        // tamanho do arquivo quando a árvore foi calculada
+    std::vector<std::vector<DIGEST>> levels; // levels[0] são as folhas, levels.back() contém só a raiz
+} MERKLE_TREE;
+
+/**
+ * @brief Calcula a árvore de Merkle de um arquivo, com as folhas calculadas em paralelo sobre um mmap
+ * @param path caminho do arquivo
+ * @param tree árvore calculada
+ * @param leafSize tamanho em bytes de cada bloco folha
+ * @param threads quantidade de threads (0 = uma por núcleo)
+ * @return true se o arquivo foi lido
+ */
+bool buildMerkle(const char *path, MERKLE_TREE &tree, size_t leafSize = MERKLE_LEAF_SIZE, int threads = 0);
+
+/**
+ * @brief Recalcula apenas as folhas que cobrem o intervalo alterado e seus caminhos até a raiz.
+ * Se o tamanho do arquivo mudou, a árvore inteira é recalculada.
+ * @param path caminho do arquivo
+ * @param tree árvore calculada anteriormente com buildMerkle
+ * @param offset primeiro byte alterado
+ * @param length quantidade de bytes alterados
+ * @return true se o arquivo foi lido
+ */
+bool updateMerkle(const char *path, MERKLE_TREE &tree, size_t offset, size_t length);
+
+/**
+ * @brief Raiz da árvore no mesmo formato hexadecimal de printSha256 (ex.: "AB:CD:...")
+ */
+std::string merkleRoot(const MERKLE_TREE &tree);
+
+#endif /* merkle_h */
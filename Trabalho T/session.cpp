@@ -0,0 +1,187 @@
+/**
+ * Sessão com alocação atrasada sobre uma imagem do sistema de arquivos que simula EXT3
+ */
+
+#include "session.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Separa um caminho completo em diretório pai e nome
+ */
+static void splitPath(const std::string &path, std::string &parent, std::string &name)
+{
+    size_t lastSlash = path.find_last_of('/');
+    parent = lastSlash == std::string::npos ? std::string("/") : path.substr(0, lastSlash + 1);
+    name = lastSlash == std::string::npos ? path : path.substr(lastSlash + 1);
+}
+
+/**
+ * @brief Maior conteúdo que cabe nos blocos diretos de um inode
+ */
+static size_t maxFileSize(const SESSION &session)
+{
+    return std::min(255, DIRECT_BLOCKS_SIZE * session.image.layout.blockSize);
+}
+
+/**
+ * @brief Abre uma sessão sobre uma imagem já inicializada
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param session sessão aberta
+ * @param maxPendingBytes quantidade de bytes pendentes que dispara um flush automático
+ * @return true se a imagem foi aberta
+ */
+bool openSession(std::string fsFileName, SESSION &session, size_t maxPendingBytes)
+{
+    session.fd = open(fsFileName.c_str(), O_RDWR);
+    if (session.fd < 0)
+        return false;
+    if (!loadImage(session.fd, session.image)) {
+        close(session.fd);
+        session.fd = -1;
+        return false;
+    }
+    session.pending.clear();
+    session.pendingBytes = 0;
+    session.maxPendingBytes = maxPendingBytes;
+    return true;
+}
+
+/**
+ * @brief Cria um diretório (somente em memória até o próximo flush)
+ * @param dirPath caminho completo do novo diretório
+ * @return true se o diretório foi criado
+ */
+bool sessionAddDir(SESSION &session, std::string dirPath)
+{
+    std::string parentPath, name;
+    splitPath(dirPath, parentPath, name);
+    int parent = lookupPath(session.fd, session.image, parentPath);
+    return parent >= 0 && createEntry(session.fd, session.image, parent, name, true, 0) >= 0;
+}
+
+/**
+ * @brief Cria um arquivo cujo conteúdo só recebe blocos no próximo flush
+ * @param filePath caminho completo do novo arquivo
+ * @param fileContent conteúdo do novo arquivo
+ * @return true se o arquivo foi criado
+ */
+bool sessionAddFile(SESSION &session, std::string filePath, std::string fileContent)
+{
+    if (fileContent.size() > maxFileSize(session))
+        return false;
+
+    std::string parentPath, name;
+    splitPath(filePath, parentPath, name);
+    int parent = lookupPath(session.fd, session.image, parentPath);
+    int inode = parent < 0 ? -1 : createEntry(session.fd, session.image, parent, name, false, 0); // No blocks yet
+    if (inode < 0)
+        return false;
+
+    session.pendingBytes += fileContent.size();
+    session.pending.push_back({inode, fileContent});
+    if (session.pendingBytes > session.maxPendingBytes)       // Memory pressure
+        return flushSession(session);
+    return true;
+}
+
+/**
+ * @brief Acrescenta conteúdo ao final de um arquivo. Um arquivo já gravado volta a ficar pendente
+ * e seus blocos são liberados, para ser realocado junto com os demais no próximo flush.
+ * @param filePath caminho completo do arquivo
+ * @param content conteúdo a ser acrescentado
+ * @return true se havia espaço no arquivo
+ */
+bool sessionAppend(SESSION &session, std::string filePath, std::string content)
+{
+    IMAGE &image = session.image;
+    int inode = lookupPath(session.fd, image, filePath);
+    if (inode < 0 || image.inodes[inode].IS_DIR == ISDIR)
+        return false;
+
+    auto it = std::find_if(session.pending.begin(), session.pending.end(),
+                           [inode](const PENDING_FILE &file) { return file.inode == inode; });
+    if (it == session.pending.end()) {                        // Already on disk: take it back into memory
+        std::string data = readFileData(session.fd, image, inode);
+        if (data.size() + content.size() > maxFileSize(session))
+            return false;
+        for (int block : inodeBlocks(image, inode))
+            freeBlock(image, block);
+        std::fill(image.inodes[inode].DIRECT_BLOCKS, image.inodes[inode].DIRECT_BLOCKS + DIRECT_BLOCKS_SIZE, 0);
+        image.inodes[inode].SIZE = 0;
+        session.pendingBytes += data.size();
+        session.pending.push_back({inode, data});
+        it = session.pending.end() - 1;
+    }
+    else if (it->content.size() + content.size() > maxFileSize(session))
+        return false;
+
+    it->content += content;
+    session.pendingBytes += content.size();
+    if (session.pendingBytes > session.maxPendingBytes)       // Memory pressure
+        return flushSession(session);
+    return true;
+}
+
+/**
+ * @brief Aloca blocos para todos os arquivos pendentes, escreve o conteúdo em uma passada
+ * sequencial e grava os metadados uma única vez
+ * @return true se houve espaço para todos os arquivos
+ */
+bool flushSession(SESSION &session)
+{
+    IMAGE &image = session.image;
+    int blockSize = image.layout.blockSize;
+
+    int total(0);
+    for (const PENDING_FILE &file : session.pending)
+        total += (file.content.size() + blockSize - 1) / blockSize;
+
+    std::vector<int> blocks = allocBlocks(image, total);        // One request: contiguous whenever possible
+    if ((int) blocks.size() != total)
+        return false;
+
+    // Lay every pending file out back to back, in the order the blocks were handed out
+    std::vector<char> data(static_cast<size_t>(total) * blockSize, 0);
+    int next(0);
+    for (const PENDING_FILE &file : session.pending) {
+        INODE &node = image.inodes[file.inode];
+        int count = (file.content.size() + blockSize - 1) / blockSize;
+        for (int j(0); j < count; j++)
+            node.DIRECT_BLOCKS[j] = blocks[next + j];
+        node.SIZE = static_cast<char>(file.content.size());
+        std::copy(file.content.begin(), file.content.end(), data.begin() + static_cast<size_t>(next) * blockSize);
+        next += count;
+    }
+
+    // One pwrite per contiguous run of blocks (a single one in the common case)
+    for (int start(0); start < total;) {
+        int end(start + 1);
+        while (end < total && blocks[end] == blocks[end - 1] + 1)
+            end++;
+        ssize_t length = static_cast<ssize_t>(end - start) * blockSize;
+        if (pwrite(session.fd, data.data() + static_cast<size_t>(start) * blockSize, length,
+                   blockOffset(image.layout, blocks[start])) != length)
+            return false;
+        start = end;
+    }
+
+    session.pending.clear();
+    session.pendingBytes = 0;
+    return flushImage(session.fd, image);
+}
+
+/**
+ * @brief Faz o flush dos arquivos pendentes e fecha a imagem
+ * @return true se o flush foi bem-sucedido
+ */
+bool closeSession(SESSION &session)
+{
+    if (session.fd < 0)
+        return false;
+    bool flushed = flushSession(session);
+    close(session.fd);
+    session.fd = -1;
+    return flushed;
+}
@@ -0,0 +1,76 @@
+/**
+ * Sessão sobre uma imagem do sistema de arquivos que simula EXT3, com alocação atrasada:
+ * o conteúdo dos arquivos fica em memória até flushSession (ou até passar do limite de memória)
+ * e então todos os arquivos pendentes recebem blocos juntos, em sequências contíguas, e são
+ * escritos em uma única passada sequencial.
+ */
+
+#ifndef session_h
+#define session_h
+#include "image.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define SESSION_MAX_PENDING (64 * 1024)
+
+typedef struct {
+    int inode;            // inode já criado, ainda sem blocos
+    std::string content;  // conteúdo a ser escrito
+} PENDING_FILE;
+
+typedef struct {
+    int fd;                             // imagem aberta durante toda a sessão
+    IMAGE image;                        // metadados em memória
+    std::vector<PENDING_FILE> pending;  // arquivos aguardando alocação
+    size_t pendingBytes;                // soma do conteúdo pendente
+    size_t maxPendingBytes;             // limite que dispara um flush automático
+} SESSION;
+
+/**
+ * @brief Abre uma sessão sobre uma imagem já inicializada
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param session sessão aberta
+ * @param maxPendingBytes quantidade de bytes pendentes que dispara um flush automático
+ * @return true se a imagem foi aberta
+ */
+bool openSession(std::string fsFileName, SESSION &session, size_t maxPendingBytes = SESSION_MAX_PENDING);
+
+/**
+ * @brief Cria um diretório (somente em memória até o próximo flush)
+ * @param dirPath caminho completo do novo diretório
+ * @return true se o diretório foi criado
+ */
+bool sessionAddDir(SESSION &session, std::string dirPath);
+
+/**
+ * @brief Cria um arquivo cujo conteúdo só recebe blocos no próximo flush
+ * @param filePath caminho completo do novo arquivo
+ * @param fileContent conteúdo do novo arquivo
+ * @return true se o arquivo foi criado
+ */
+bool sessionAddFile(SESSION &session, std::string filePath, std::string fileContent);
+
+/**
+ * @brief Acrescenta conteúdo ao final de um arquivo. Um arquivo já gravado volta a ficar pendente
+ * e seus blocos são liberados, para ser realocado junto com os demais no próximo flush.
+ * @param filePath caminho completo do arquivo
+ * @param content conteúdo a ser acrescentado
+ * @return true se havia espaço no arquivo
+ */
+bool sessionAppend(SESSION &session, std::string filePath, std::string content);
+
+/**
+ * @brief Aloca blocos para todos os arquivos pendentes, escreve o conteúdo em uma passada
+ * sequencial e grava os metadados uma única vez
+ * @return true se houve espaço para todos os arquivos
+ */
+bool flushSession(SESSION &session);
+
+/**
+ * @brief Faz o flush dos arquivos pendentes e fecha a imagem
+ * @return true se o flush foi bem-sucedido
+ */
+bool closeSession(SESSION &session);
+
+#endif /* session_h */
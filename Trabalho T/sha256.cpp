@@ -9,6 +9,12 @@
 #include "sha256.h"
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
 #include <openssl/evp.h>
 
 #if OPENSSL_VERSION_NUMBER >= 0x3000000000L
@@ -150,4 +156,64 @@ std::string printSha256(const char *path){
     return hexHash;
 }
 
-#endif
\ No newline at end of file
+#endif
+
+// Tamanho de cada leitura do lote (alinhado à página)
+#define BATCH_READ_SIZE (1 << 20)
+
+// Hash de um arquivo usando o contexto e o buffer da thread
+static std::string batchDigest(EVP_MD_CTX *mdctx, unsigned char *buffer, const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::string("");
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL);
+    ssize_t n;
+    while ((n = read(fd, buffer, BATCH_READ_SIZE)) > 0)
+        EVP_DigestUpdate(mdctx, buffer, n);
+    close(fd);
+    if (n < 0)
+        return std::string("");
+
+    unsigned char md_value[EVP_MAX_MD_SIZE];
+    unsigned int md_len;
+    EVP_DigestFinal_ex(mdctx, md_value, &md_len);
+
+    char *hexOut = OPENSSL_buf2hexstr(md_value, md_len);
+    std::string hexHash(hexOut);
+    OPENSSL_free(hexOut);
+    return hexHash;
+}
+
+std::vector<std::string> printSha256Batch(const std::vector<std::string> &paths, int threads)
+{
+    std::vector<std::string> hashes(paths.size());
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<size_t>(threads, paths.size());
+
+    // Cada thread pega o próximo arquivo da lista; o resultado vai para a posição do arquivo
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+        void *buffer = NULL;
+        if (posix_memalign(&buffer, 4096, BATCH_READ_SIZE) == 0) {
+            for (size_t i = next++; i < paths.size(); i = next++)
+                hashes[i] = batchDigest(mdctx, static_cast<unsigned char*>(buffer), paths[i]);
+            free(buffer);
+        }
+        EVP_MD_CTX_free(mdctx);
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+        pool.emplace_back(worker);
+    if (threads > 0)
+        worker();
+    for (std::thread &thread : pool)
+        thread.join();
+
+    return hashes;
+}
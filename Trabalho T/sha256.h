@@ -13,8 +13,14 @@
 #include <openssl/sha.h>
 #include <openssl/bio.h>
 #include <string>
+#include <vector>
 
 std::string printSha256(const char *path);
 
+// Calcula o SHA-256 de vários arquivos em paralelo, cada thread com um único EVP_MD_CTX reutilizado e
+// leituras grandes e alinhadas. Os resultados seguem a ordem de paths, no mesmo formato de printSha256;
+// arquivos que não puderam ser lidos resultam em string vazia. threads = 0 usa uma thread por núcleo.
+std::vector<std::string> printSha256Batch(const std::vector<std::string> &paths, int threads = 0);
+
 
 #endif /* sha256_hpp */
@@ -0,0 +1,267 @@
+/**
+ * Acesso de vários processos a uma mesma imagem do sistema de arquivos que simula EXT3
+ */
+
+#include "shared.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SHARED_MAGIC 0x46534C4B   // "FSLK"
+#define JOURNAL_EMPTY 0
+#define JOURNAL_WRITING 1
+#define JOURNAL_COMMITTED 2
+
+typedef struct {
+    unsigned int offset;  // offset na imagem
+    unsigned int length;  // bytes que seguem este cabeçalho no journal
+} JOURNAL_ENTRY;
+
+/**
+ * @brief Área do journal, logo após o SHARED_LOCK
+ */
+static unsigned char *journal(SHARED_IMAGE &shared)
+{
+    return reinterpret_cast<unsigned char*>(shared.lock) + sizeof(SHARED_LOCK);
+}
+
+/**
+ * @brief Aplica ao mapeamento as entradas de um journal confirmado
+ */
+static void replayJournal(SHARED_IMAGE &shared)
+{
+    unsigned char *entries = journal(shared);
+    for (unsigned int position(0); position < shared.lock->journalLength;) {
+        JOURNAL_ENTRY entry;
+        memcpy(&entry, entries + position, sizeof(entry));
+        position += sizeof(entry);
+        memcpy(shared.map + entry.offset, entries + position, entry.length);
+        position += entry.length;
+    }
+}
+
+/**
+ * @brief Obtém o mutex compartilhado, recuperando o estado deixado por um dono que morreu
+ */
+static bool acquire(SHARED_IMAGE &shared)
+{
+    int rc = pthread_mutex_lock(&shared.lock->mutex);
+    if (rc == EOWNERDEAD) {
+        if (shared.lock->journalState == JOURNAL_COMMITTED)  // Died while applying: finish the job
+            replayJournal(shared);
+        shared.lock->journalState = JOURNAL_EMPTY;           // Died while journaling: mapping is untouched
+        shared.lock->recoveries++;
+        pthread_mutex_consistent(&shared.lock->mutex);
+        return true;
+    }
+    return rc == 0;
+}
+
+/**
+ * @brief Mapeia uma imagem já inicializada para acesso compartilhado, criando o arquivo de lock se necessário
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param shared imagem compartilhada aberta
+ * @return true se a imagem e o arquivo de lock foram mapeados
+ */
+bool openSharedImage(std::string fsFileName, SHARED_IMAGE &shared)
+{
+    shared.map = NULL;
+    shared.lock = NULL;
+    shared.lockFd = -1;
+    shared.fd = open(fsFileName.c_str(), O_RDWR);
+    if (shared.fd < 0 || !readLayout(shared.fd, shared.layout)) {
+        closeSharedImage(shared);
+        return false;
+    }
+
+    struct stat image;                                           // A short image would SIGBUS on first access
+    if (fstat(shared.fd, &image) < 0 || image.st_size < shared.layout.imageSize) {
+        closeSharedImage(shared);
+        return false;
+    }
+    void *map = mmap(NULL, shared.layout.imageSize, PROT_READ | PROT_WRITE, MAP_SHARED, shared.fd, 0);
+    if (map == MAP_FAILED) {
+        closeSharedImage(shared);
+        return false;
+    }
+    shared.map = static_cast<unsigned char*>(map);
+
+    // Room for the lock plus a journal able to hold every metadata and directory byte of the image
+    size_t capacity = 2 * shared.layout.imageSize + 64 * sizeof(JOURNAL_ENTRY);
+    shared.lockSize = sizeof(SHARED_LOCK) + capacity;
+    shared.lockFd = open((fsFileName + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+    if (shared.lockFd < 0 || flock(shared.lockFd, LOCK_EX) < 0) {   // Only one process initializes the lock
+        closeSharedImage(shared);
+        return false;
+    }
+
+    struct stat st;
+    bool ok = fstat(shared.lockFd, &st) == 0;
+    if (ok && static_cast<size_t>(st.st_size) < shared.lockSize)
+        ok = ftruncate(shared.lockFd, shared.lockSize) == 0;
+    else if (ok)
+        shared.lockSize = st.st_size;
+    void *lock = ok ? mmap(NULL, shared.lockSize, PROT_READ | PROT_WRITE, MAP_SHARED, shared.lockFd, 0) : MAP_FAILED;
+    if (lock != MAP_FAILED) {
+        shared.lock = static_cast<SHARED_LOCK*>(lock);
+        if (shared.lock->magic != SHARED_MAGIC) {
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            pthread_mutex_init(&shared.lock->mutex, &attr);
+            pthread_mutexattr_destroy(&attr);
+            shared.lock->generation = 0;
+            shared.lock->journalState = JOURNAL_EMPTY;
+            shared.lock->journalLength = 0;
+            shared.lock->journalCapacity = shared.lockSize - sizeof(SHARED_LOCK);
+            shared.lock->recoveries = 0;
+            shared.lock->magic = SHARED_MAGIC;
+        }
+    }
+    flock(shared.lockFd, LOCK_UN);
+
+    if (shared.lock == NULL) {
+        closeSharedImage(shared);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Desfaz os mapeamentos e fecha os arquivos
+ */
+void closeSharedImage(SHARED_IMAGE &shared)
+{
+    if (shared.lock != NULL)
+        munmap(shared.lock, shared.lockSize);
+    if (shared.map != NULL)
+        munmap(shared.map, shared.layout.imageSize);
+    if (shared.lockFd >= 0)
+        close(shared.lockFd);
+    if (shared.fd >= 0)
+        close(shared.fd);
+    shared.lock = NULL;
+    shared.map = NULL;
+    shared.lockFd = -1;
+    shared.fd = -1;
+}
+
+/**
+ * @brief Acrescenta uma entrada ao journal
+ * @return false se o journal está cheio
+ */
+static bool journalAppend(SHARED_IMAGE &shared, unsigned int offset, const void *bytes, unsigned int length)
+{
+    if (shared.lock->journalLength + sizeof(JOURNAL_ENTRY) + length > shared.lock->journalCapacity)
+        return false;
+    JOURNAL_ENTRY entry{offset, length};
+    memcpy(journal(shared) + shared.lock->journalLength, &entry, sizeof(entry));
+    memcpy(journal(shared) + shared.lock->journalLength + sizeof(entry), bytes, length);
+    shared.lock->journalLength += sizeof(entry) + length;
+    return true;
+}
+
+/**
+ * @brief Confirma os metadados alterados: journal primeiro, mapeamento depois
+ */
+static bool commit(SHARED_IMAGE &shared, IMAGE &image)
+{
+    shared.lock->journalState = JOURNAL_WRITING;
+    shared.lock->journalLength = 0;
+    bool ok = journalAppend(shared, HEADER_SIZE, image.bitmap.data(), image.layout.bitmapSize) &&
+              journalAppend(shared, image.layout.inodeStart, image.inodes.data(), INODE_SIZE * image.layout.numInodes);
+    for (int block : image.dirtyBlocks)
+        ok = ok && journalAppend(shared, blockOffset(image.layout, block), image.dirBlocks[block].data(), image.layout.blockSize);
+    if (!ok) {
+        shared.lock->journalState = JOURNAL_EMPTY;
+        return false;
+    }
+
+    __atomic_store_n(&shared.lock->journalState, JOURNAL_COMMITTED, __ATOMIC_RELEASE); // From here on the change survives a crash
+    replayJournal(shared);
+    __atomic_store_n(&shared.lock->journalState, JOURNAL_EMPTY, __ATOMIC_RELEASE);
+    image.dirtyBlocks.clear();
+    return true;
+}
+
+/**
+ * @brief Executa uma alteração com o mutex compartilhado obtido. update recebe uma cópia dos metadados
+ * (IMAGE) e o descritor da imagem; se retornar true, os metadados alterados são confirmados via journal.
+ * @return false se o mutex não pôde ser obtido, se update retornou false ou se o journal não coube
+ */
+bool sharedUpdate(SHARED_IMAGE &shared, const std::function<bool(int fd, IMAGE &image)> &update)
+{
+    if (!acquire(shared))
+        return false;
+
+    // Bitmap and inodes are copied out of the shared mapping without syscalls. Directory blocks are still
+    // pread through fd by lookupPath, which sees the same page cache as the mapping.
+    IMAGE image;
+    image.layout = shared.layout;
+    image.bitmap.assign(shared.map + HEADER_SIZE, shared.map + HEADER_SIZE + shared.layout.bitmapSize);
+    image.inodes.resize(shared.layout.numInodes);
+    memcpy(image.inodes.data(), shared.map + shared.layout.inodeStart, INODE_SIZE * shared.layout.numInodes);
+    image.nextInode = ROOT_INODE + 1;
+    image.nextBlock = 0;
+
+    bool ok = update(shared.fd, image) && commit(shared, image);
+    if (ok)
+        shared.lock->generation++;
+    pthread_mutex_unlock(&shared.lock->mutex);
+    return ok;
+}
+
+/**
+ * @brief Separa um caminho completo em diretório pai e nome
+ */
+static void splitPath(const std::string &path, std::string &parent, std::string &name)
+{
+    size_t lastSlash = path.find_last_of('/');
+    parent = lastSlash == std::string::npos ? std::string("/") : path.substr(0, lastSlash + 1);
+    name = lastSlash == std::string::npos ? path : path.substr(lastSlash + 1);
+}
+
+/**
+ * @brief Adiciona um arquivo à imagem compartilhada
+ * @param filePath caminho completo do novo arquivo
+ * @param fileContent conteúdo do novo arquivo
+ */
+bool sharedAddFile(SHARED_IMAGE &shared, std::string filePath, std::string fileContent)
+{
+    std::string parentPath, name;
+    splitPath(filePath, parentPath, name);
+    return sharedUpdate(shared, [&](int fd, IMAGE &image) {
+        int parent = lookupPath(fd, image, parentPath);
+        int inode = parent < 0 ? -1 : createEntry(fd, image, parent, name, false, fileContent.size());
+        if (inode < 0)
+            return false;
+
+        size_t done(0);                                      // Data goes straight into the shared mapping
+        for (int block : inodeBlocks(image, inode)) {
+            size_t length = std::min<size_t>(image.layout.blockSize, fileContent.size() - done);
+            memcpy(shared.map + blockOffset(image.layout, block), fileContent.data() + done, length);
+            done += length;
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief Adiciona um diretório à imagem compartilhada
+ * @param dirPath caminho completo do novo diretório
+ */
+bool sharedAddDir(SHARED_IMAGE &shared, std::string dirPath)
+{
+    std::string parentPath, name;
+    splitPath(dirPath, parentPath, name);
+    return sharedUpdate(shared, [&](int fd, IMAGE &image) {
+        int parent = lookupPath(fd, image, parentPath);
+        return parent >= 0 && createEntry(fd, image, parent, name, true, 0) >= 0;
+    });
+}
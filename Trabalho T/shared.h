@@ -0,0 +1,71 @@
+/**
+ * Acesso de vários processos a uma mesma imagem do sistema de arquivos que simula EXT3.
+ *
+ * A imagem inteira (cabeçalho, mapa de bits, inodes e blocos) é mapeada com MAP_SHARED em todos os
+ * processos. As alterações são serializadas por um pthread_mutex_t robusto e compartilhado entre
+ * processos, guardado junto com um pequeno journal no arquivo "<imagem>.lock". Cada alteração de
+ * metadados é primeiro copiada para o journal e só então aplicada ao mapeamento; se um processo
+ * morrer segurando o mutex, o próximo processo a obtê-lo recebe EOWNERDEAD, refaz o journal
+ * confirmado (ou o descarta, se estava incompleto) e continua.
+ */
+
+#ifndef shared_h
+#define shared_h
+#include "image.h"
+#include <functional>
+#include <pthread.h>
+#include <string>
+
+typedef struct {
+    unsigned int magic;             // SHARED_MAGIC depois de inicializado
+    pthread_mutex_t mutex;          // robusto e compartilhado entre processos
+    unsigned long generation;       // incrementado a cada alteração confirmada
+    unsigned int journalState;      // JOURNAL_EMPTY, JOURNAL_WRITING ou JOURNAL_COMMITTED
+    unsigned int journalLength;     // bytes válidos no journal
+    unsigned int journalCapacity;   // tamanho da área do journal
+    unsigned int recoveries;        // quantas vezes um dono morto foi detectado
+} SHARED_LOCK;
+
+typedef struct {
+    int fd;                 // imagem
+    int lockFd;             // arquivo "<imagem>.lock"
+    LAYOUT layout;          // geometria da imagem
+    unsigned char *map;     // imagem inteira mapeada com MAP_SHARED
+    SHARED_LOCK *lock;      // arquivo de lock mapeado com MAP_SHARED
+    size_t lockSize;        // tamanho do mapeamento do arquivo de lock
+} SHARED_IMAGE;
+
+/**
+ * @brief Mapeia uma imagem já inicializada para acesso compartilhado, criando o arquivo de lock se necessário
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @param shared imagem compartilhada aberta
+ * @return true se a imagem e o arquivo de lock foram mapeados
+ */
+bool openSharedImage(std::string fsFileName, SHARED_IMAGE &shared);
+
+/**
+ * @brief Desfaz os mapeamentos e fecha os arquivos
+ */
+void closeSharedImage(SHARED_IMAGE &shared);
+
+/**
+ * @brief Executa uma alteração com o mutex compartilhado obtido. update recebe uma cópia dos metadados
+ * (IMAGE) e o descritor da imagem; se retornar true, os metadados alterados são confirmados via journal.
+ * @return false se o mutex não pôde ser obtido, se update retornou false ou se o journal não coube
+ */
+bool sharedUpdate(SHARED_IMAGE &shared, const std::function<bool(int fd, IMAGE &image)> &update);
+
+/**
+ * @brief Adiciona um arquivo à imagem compartilhada
+ * @param filePath caminho completo do novo arquivo
+ * @param fileContent conteúdo do novo arquivo
+ */
+bool sharedAddFile(SHARED_IMAGE &shared, std::string filePath, std::string fileContent);
+
+/**
+ * @brief Adiciona um diretório à imagem compartilhada
+ * @param dirPath caminho completo do novo diretório
+ */
+bool sharedAddDir(SHARED_IMAGE &shared, std::string dirPath);
+
+#endif /* shared_h */
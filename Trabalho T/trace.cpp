@@ -0,0 +1,204 @@
+/**
+ * Gravação e reprodução de sequências de operações do sistema de arquivos que simula EXT3
+ */
+
+#include "trace.h"
+#include "fs.h"
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+static std::mutex traceMutex;                             // Serializes writers from several threads
+static std::ofstream traceFile;
+static std::chrono::steady_clock::time_point traceBegin;
+static std::atomic<bool> traceActive(false);             // Written under traceMutex, read without it
+
+/**
+ * @brief Escreve um inteiro little-endian com size bytes
+ */
+static void writeLE(std::ostream &out, uint64_t value, int size)
+{
+    for (int i(0); i < size; i++)
+        out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+/**
+ * @brief Lê um inteiro little-endian com size bytes
+ */
+static bool readLE(std::istream &in, uint64_t &value, int size)
+{
+    unsigned char bytes[8];
+    if (!in.read(reinterpret_cast<char*>(bytes), size))
+        return false;
+    value = 0;
+    for (int i(0); i < size; i++)
+        value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    return true;
+}
+
+/**
+ * @brief Começa a gravar todas as chamadas de initFs/addFile/addDir/remove/move
+ * @param traceFileName arquivo que recebe o trace (sobrescrito)
+ * @return true se o arquivo foi criado
+ */
+bool startTrace(std::string traceFileName)
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (traceFile.is_open())
+        traceFile.close();
+    traceFile.open(traceFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!traceFile)
+        return false;
+
+    traceFile.write("FSTR", 4);
+    writeLE(traceFile, TRACE_VERSION, 4);
+    traceBegin = std::chrono::steady_clock::now();
+    traceActive = true;
+    return true;
+}
+
+/**
+ * @brief Encerra a gravação e fecha o arquivo de trace
+ */
+void stopTrace()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceActive = false;
+    if (traceFile.is_open())
+        traceFile.close();
+}
+
+/**
+ * @brief Indica se há uma gravação em andamento
+ */
+bool tracing()
+{
+    return traceActive;
+}
+
+/**
+ * @brief Lê todos os registros de um arquivo de trace
+ * @return true se o arquivo é um trace válido
+ */
+bool readTrace(std::string traceFileName, std::vector<TRACE_RECORD> &records)
+{
+    std::ifstream file(traceFileName, std::ios::binary);
+    char magic[4];
+    uint64_t version;
+    if (!file.read(magic, 4) || memcmp(magic, "FSTR", 4) != 0 || !readLE(file, version, 4) || version != TRACE_VERSION)
+        return false;
+
+    records.clear();
+    uint64_t op;
+    while (readLE(file, op, 1)) {
+        TRACE_RECORD record;
+        uint64_t numStrings, numInts;
+        record.op = op;
+        if (!readLE(file, numStrings, 1) || !readLE(file, numInts, 1) ||
+            !readLE(file, record.start, 8) || !readLE(file, record.duration, 8))
+            return false;
+
+        for (uint64_t i(0); i < numStrings; i++) {
+            uint64_t length;
+            if (!readLE(file, length, 4))
+                return false;
+            std::string value(length, 0);
+            if (length > 0 && !file.read(&value[0], length))
+                return false;
+            record.strings.push_back(value);
+        }
+        for (uint64_t i(0); i < numInts; i++) {
+            uint64_t value;
+            if (!readLE(file, value, 4))
+                return false;
+            record.ints.push_back(static_cast<int32_t>(value));
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+/**
+ * @brief Executa novamente uma operação gravada
+ * @param record operação gravada
+ * @param fsFileName se não vazio, substitui a imagem gravada
+ */
+void replayRecord(const TRACE_RECORD &record, const std::string &fsFileName)
+{
+    const std::vector<std::string> &s = record.strings;
+    const std::vector<int> &n = record.ints;
+    std::string image = fsFileName.empty() && !s.empty() ? s[0] : fsFileName;
+
+    switch (record.op) {
+        case TRACE_INIT_FS:
+            if (s.size() == 1 && n.size() == 3)
+                initFs(image, n[0], n[1], n[2]);
+            break;
+        case TRACE_ADD_FILE:
+            if (s.size() == 3)
+                addFile(image, s[1], s[2]);
+            break;
+        case TRACE_ADD_DIR:
+            if (s.size() == 2)
+                addDir(image, s[1]);
+            break;
+        case TRACE_REMOVE:
+            if (s.size() == 2)
+                remove(image, s[1]);
+            break;
+        case TRACE_MOVE:
+            if (s.size() == 3)
+                move(image, s[1], s[2]);
+            break;
+    }
+}
+
+/**
+ * @brief Nome da operação de um registro (ex.: "addFile")
+ */
+const char *traceOpName(unsigned char op)
+{
+    switch (op) {
+        case TRACE_INIT_FS:  return "initFs";
+        case TRACE_ADD_FILE: return "addFile";
+        case TRACE_ADD_DIR:  return "addDir";
+        case TRACE_REMOVE:   return "remove";
+        case TRACE_MOVE:     return "move";
+    }
+    return "unknown";
+}
+
+TraceScope::TraceScope(unsigned char op, std::initializer_list<std::reference_wrapper<const std::string>> strings,
+                       std::vector<int> ints)
+    : active(traceActive)
+{
+    if (!active)
+        return;
+    record.op = op;
+    record.strings.assign(strings.begin(), strings.end());  // Arguments are only copied while tracing
+    record.ints = std::move(ints);
+    begin = std::chrono::steady_clock::now();
+}
+
+TraceScope::~TraceScope()
+{
+    if (!active)
+        return;
+    auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (!traceActive)                                     // Trace stopped while the operation ran
+        return;
+    writeLE(traceFile, record.op, 1);
+    writeLE(traceFile, record.strings.size(), 1);
+    writeLE(traceFile, record.ints.size(), 1);
+    writeLE(traceFile, std::chrono::duration_cast<std::chrono::nanoseconds>(begin - traceBegin).count(), 8);
+    writeLE(traceFile, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), 8);
+    for (const std::string &value : record.strings) {
+        writeLE(traceFile, value.size(), 4);
+        traceFile.write(value.data(), value.size());
+    }
+    for (int value : record.ints)
+        writeLE(traceFile, static_cast<uint32_t>(value), 4);
+}
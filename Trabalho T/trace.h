@@ -0,0 +1,87 @@
+/**
+ * Gravação e reprodução de sequências de operações do sistema de arquivos que simula EXT3
+ *
+ * Formato do arquivo de trace (inteiros little-endian):
+ *   cabeçalho: "FSTR" (4 bytes), versão (uint32)
+ *   registro:  operação (uint8), quantidade de strings (uint8), quantidade de inteiros (uint8),
+ *              início em ns desde o início do trace (uint64), duração em ns (uint64),
+ *              strings (uint32 tamanho + bytes), inteiros (int32)
+ */
+
+#ifndef trace_h
+#define trace_h
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#define TRACE_VERSION 1
+
+#define TRACE_INIT_FS 1
+#define TRACE_ADD_FILE 2
+#define TRACE_ADD_DIR 3
+#define TRACE_REMOVE 4
+#define TRACE_MOVE 5
+
+typedef struct {
+    unsigned char op;                   // TRACE_INIT_FS, TRACE_ADD_FILE, ...
+    uint64_t start;                     // início em ns desde o início do trace
+    uint64_t duration;                  // duração em ns
+    std::vector<std::string> strings;   // argumentos string, na ordem da função
+    std::vector<int> ints;              // argumentos inteiros, na ordem da função
+} TRACE_RECORD;
+
+/**
+ * @brief Começa a gravar todas as chamadas de initFs/addFile/addDir/remove/move
+ * @param traceFileName arquivo que recebe o trace (sobrescrito)
+ * @return true se o arquivo foi criado
+ */
+bool startTrace(std::string traceFileName);
+
+/**
+ * @brief Encerra a gravação e fecha o arquivo de trace
+ */
+void stopTrace();
+
+/**
+ * @brief Indica se há uma gravação em andamento
+ */
+bool tracing();
+
+/**
+ * @brief Lê todos os registros de um arquivo de trace
+ * @return true se o arquivo é um trace válido
+ */
+bool readTrace(std::string traceFileName, std::vector<TRACE_RECORD> &records);
+
+/**
+ * @brief Executa novamente uma operação gravada
+ * @param record operação gravada
+ * @param fsFileName se não vazio, substitui a imagem gravada
+ */
+void replayRecord(const TRACE_RECORD &record, const std::string &fsFileName);
+
+/**
+ * @brief Nome da operação de um registro (ex.: "addFile")
+ */
+const char *traceOpName(unsigned char op);
+
+/**
+ * Grava a operação ao sair do escopo, com a duração medida desde a construção.
+ * Não faz nada (nem copia os argumentos) quando não há gravação em andamento.
+ */
+class TraceScope {
+public:
+    TraceScope(unsigned char op, std::initializer_list<std::reference_wrapper<const std::string>> strings,
+               std::vector<int> ints);
+    ~TraceScope();
+
+private:
+    bool active;
+    TRACE_RECORD record;
+    std::chrono::steady_clock::time_point begin;
+};
+
+#endif /* trace_h */
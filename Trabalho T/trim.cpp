@@ -0,0 +1,104 @@
+/**
+ * Liberação de blocos livres (hole punching) em imagens do sistema de arquivos que simula EXT3
+ */
+
+#include "trim.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+static bool punchEnabled(false);
+
+/**
+ * @brief Habilita ou desabilita a liberação do espaço em disco dos blocos liberados por remove
+ * @param enabled true para perfurar (FALLOC_FL_PUNCH_HOLE) os blocos liberados
+ */
+void setPunchOnFree(bool enabled)
+{
+    punchEnabled = enabled;
+}
+
+/**
+ * @brief Indica se os blocos liberados por remove são perfurados na imagem
+ */
+bool punchOnFree()
+{
+    return punchEnabled;
+}
+
+/**
+ * @brief Perfura um intervalo de bytes, zerando-o manualmente se o sistema de arquivos não suportar
+ * @return true em caso de sucesso
+ */
+static bool punchRange(int fd, off_t offset, off_t length)
+{
+    if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length) == 0)
+        return true;
+    if (errno != EOPNOTSUPP && errno != ENOSYS) // Real error, not just a missing feature
+        return false;
+
+    std::vector<char> zeros(length, 0);         // Fallback: the freed bytes still have to go away
+    return pwrite(fd, zeros.data(), length, offset) == length;
+}
+
+/**
+ * @brief Perfura os blocos informados, agrupando blocos adjacentes em uma única chamada
+ * @param fd descritor de arquivo aberto (escrita) da imagem
+ * @param layout geometria da imagem
+ * @param blocks índices dos blocos a serem perfurados, em qualquer ordem
+ * @return quantidade de intervalos perfurados ou -1 em caso de erro
+ */
+int punchBlocks(int fd, const LAYOUT &layout, std::vector<int> blocks)
+{
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+    int ranges(0);
+    for (size_t i(0); i < blocks.size();) {
+        size_t j(i + 1);
+        while (j < blocks.size() && blocks[j] == blocks[j - 1] + 1) // Extend the range while blocks are adjacent
+            j++;
+
+        off_t offset = blockOffset(layout, blocks[i]);
+        off_t length = static_cast<off_t>(j - i) * layout.blockSize;
+        if (!punchRange(fd, offset, length))
+            return -1;
+        ranges++;
+        i = j;
+    }
+    return ranges;
+}
+
+/**
+ * @brief Perfura todos os blocos marcados como livres no mapa de bits de uma imagem existente
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @return quantidade de intervalos perfurados ou -1 em caso de erro
+ */
+int trim(std::string fsFileName)
+{
+    int fd = open(fsFileName.c_str(), O_RDWR);
+    if (fd < 0)
+        return -1;
+
+    LAYOUT layout;
+    if (!readLayout(fd, layout)) {
+        close(fd);
+        return -1;
+    }
+
+    std::vector<unsigned char> bitmap(layout.bitmapSize);
+    if (pread(fd, bitmap.data(), layout.bitmapSize, HEADER_SIZE) != layout.bitmapSize) {
+        close(fd);
+        return -1;
+    }
+
+    std::vector<int> freeBlocks;
+    for (int i(0); i < layout.numBlocks; i++) // For each block
+        if (!isBlockUsed(bitmap.data(), i))   // If the bitmap says it is free
+            freeBlocks.push_back(i);          // Its bytes can be released
+
+    int ranges = punchBlocks(fd, layout, freeBlocks);
+    close(fd);
+    return ranges;
+}
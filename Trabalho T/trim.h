@@ -0,0 +1,38 @@
+/**
+ * Liberação de blocos livres (hole punching) em imagens do sistema de arquivos que simula EXT3
+ */
+
+#ifndef trim_h
+#define trim_h
+#include "layout.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Habilita ou desabilita a liberação do espaço em disco dos blocos liberados por remove
+ * @param enabled true para perfurar (FALLOC_FL_PUNCH_HOLE) os blocos liberados
+ */
+void setPunchOnFree(bool enabled);
+
+/**
+ * @brief Indica se os blocos liberados por remove são perfurados na imagem
+ */
+bool punchOnFree();
+
+/**
+ * @brief Perfura os blocos informados, agrupando blocos adjacentes em uma única chamada
+ * @param fd descritor de arquivo aberto (escrita) da imagem
+ * @param layout geometria da imagem
+ * @param blocks índices dos blocos a serem perfurados, em qualquer ordem
+ * @return quantidade de intervalos perfurados ou -1 em caso de erro
+ */
+int punchBlocks(int fd, const LAYOUT &layout, std::vector<int> blocks);
+
+/**
+ * @brief Perfura todos os blocos marcados como livres no mapa de bits de uma imagem existente
+ * @param fsFileName arquivo que contém um sistema sistema de arquivos que simula EXT3.
+ * @return quantidade de intervalos perfurados ou -1 em caso de erro
+ */
+int trim(std::string fsFileName);
+
+#endif /* trim_h */
@@ -0,0 +1,176 @@
+/**
+ * Busca vetorizada de nomes na lista encadeada em disco
+ */
+
+#include "busca.h"
+#include "lista.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BUSCA_X86 1
+#endif
+
+/**
+ * @brief Padrão comparado com o início de cada registro: used = 1 seguido do nome completado com zeros
+ * @return quantos bytes do padrão contam: used, o nome e o '\0' final (os bytes depois dele podem ter lixo)
+ */
+static size_t makePattern(const std::string &nome, unsigned char pattern[32])
+{
+    memset(pattern, 0, 32);
+    REGISTRO record = makeRecord(nome, 0);
+    memcpy(pattern, &record, sizeof(int) + NAME_SIZE);
+    return sizeof(int) + std::min<size_t>(nome.size() + 1, NAME_SIZE);
+}
+
+static void scanScalar(const char *data, size_t first, size_t size, const unsigned char *pattern, size_t length,
+                       std::vector<int> &found)
+{
+    for (size_t address(first); address + RECORD_SIZE <= size; address += RECORD_SIZE)
+        if (memcmp(data + address, pattern, length) == 0)
+            found.push_back(static_cast<int>(address));
+}
+
+#ifdef BUSCA_X86
+/**
+ * @brief Duas comparações de 16 bytes por registro: [0, 16) e [8, 24)
+ */
+__attribute__((target("sse2")))
+static size_t scanSse2(const char *data, size_t size, const unsigned char *pattern, size_t length, std::vector<int> &found)
+{
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + 8));
+    const unsigned int mask = (1u << length) - 1;
+    size_t address(HEAD_SIZE);
+    for (; address + RECORD_SIZE <= size; address += RECORD_SIZE) {
+        unsigned int a = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + address)), low));
+        unsigned int b = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + address + 8)), high));
+        if (((a | b << 8) & mask) == mask)
+            found.push_back(static_cast<int>(address));
+    }
+    return address;
+}
+
+/**
+ * @brief Compara os bytes de mask do início de um registro com o padrão em uma comparação de 32 bytes
+ */
+__attribute__((target("avx2")))
+static inline bool matchesAvx2(const char *record, const unsigned char *pattern, unsigned int mask)
+{
+    __m256i target = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern));
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(record));
+    return (static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, target))) & mask) == mask;
+}
+
+/**
+ * @brief Uma comparação de 32 bytes por registro, quatro registros por iteração
+ */
+__attribute__((target("avx2")))
+static size_t scanAvx2(const char *data, size_t size, const unsigned char *pattern, size_t length, std::vector<int> &found)
+{
+    const unsigned int mask = (1u << length) - 1;
+    size_t address(HEAD_SIZE);
+    for (; address + 3 * RECORD_SIZE + 32 <= size; address += 4 * RECORD_SIZE) { // 32-byte loads stay inside data
+        bool m0 = matchesAvx2(data + address, pattern, mask);
+        bool m1 = matchesAvx2(data + address + RECORD_SIZE, pattern, mask);
+        bool m2 = matchesAvx2(data + address + 2 * RECORD_SIZE, pattern, mask);
+        bool m3 = matchesAvx2(data + address + 3 * RECORD_SIZE, pattern, mask);
+        if (m0 | m1 | m2 | m3) {                                  // Rare: keep the common path branch-free
+            if (m0) found.push_back(static_cast<int>(address));
+            if (m1) found.push_back(static_cast<int>(address + RECORD_SIZE));
+            if (m2) found.push_back(static_cast<int>(address + 2 * RECORD_SIZE));
+            if (m3) found.push_back(static_cast<int>(address + 3 * RECORD_SIZE));
+        }
+    }
+    return address;
+}
+#endif
+
+/**
+ * @brief Implementação usada por BUSCA_AUTOMATICA nesta CPU
+ */
+IMPLEMENTACAO_BUSCA implementacaoBusca()
+{
+#ifdef BUSCA_X86
+    static const IMPLEMENTACAO_BUSCA best = __builtin_cpu_supports("avx2") ? BUSCA_AVX2 :
+                                            __builtin_cpu_supports("sse2") ? BUSCA_SSE2 : BUSCA_ESCALAR;
+    return best;
+#else
+    return BUSCA_ESCALAR;
+#endif
+}
+
+/**
+ * @brief Endereços, em ordem crescente, dos registros usados cujo nome é igual a nome
+ * @param data bytes da lista a partir do cabeçalho (leitura em bloco ou mapeamento)
+ * @param size quantidade de bytes em data
+ * @param implementacao implementação a ser usada (uma indisponível na CPU cai na escalar)
+ */
+std::vector<int> procuraNomes(const char *data, size_t size, const std::string &nome, IMPLEMENTACAO_BUSCA implementacao)
+{
+    std::vector<int> found;
+    if (nome.size() > NAME_SIZE)                                  // Could never match a 20-byte field
+        return found;
+    unsigned char pattern[32];
+    size_t length = makePattern(nome, pattern);
+
+    IMPLEMENTACAO_BUSCA best = implementacaoBusca();
+    if (implementacao == BUSCA_AUTOMATICA || implementacao > best)
+        implementacao = best;
+
+    size_t tail(HEAD_SIZE);                                       // First record left for the scalar loop
+#ifdef BUSCA_X86
+    if (implementacao == BUSCA_AVX2)
+        tail = scanAvx2(data, size, pattern, length, found);
+    else if (implementacao == BUSCA_SSE2)
+        tail = scanSse2(data, size, pattern, length, found);
+#endif
+    scanScalar(data, tail, size, pattern, length, found);
+    return found;
+}
+
+/**
+ * @brief Primeiro registro da lista com um nome, como no percurso de adiciona, usando a busca vetorizada.
+ * Se houver mais de um registro com o nome, os ponteiros são seguidos (sem ler nomes) para escolher o primeiro.
+ * Registros fora da lista ficam com used = 0 (remove e adicionaConcorrente garantem isso), então um
+ * único registro usado com o nome pertence à lista.
+ * @param data bytes da lista a partir do cabeçalho
+ * @param size quantidade de bytes em data
+ * @return endereço do registro ou LIST_END
+ */
+int primeiroComNome(const char *data, size_t size, const std::string &nome)
+{
+    std::vector<int> found = procuraNomes(data, size, nome);
+    if (found.size() <= 1)                                        // No pointer chase for the common case
+        return found.empty() ? LIST_END : found[0];
+
+    int address;
+    memcpy(&address, data, HEAD_SIZE);
+    for (size_t hops(0); address >= 0 && static_cast<size_t>(address) + RECORD_SIZE <= size && hops <= size / RECORD_SIZE;
+         hops++) {
+        if (std::binary_search(found.begin(), found.end(), address))
+            return address;
+        memcpy(&address, data + address + REG_SIZE, sizeof(int));
+    }
+    return LIST_END;
+}
+
+/**
+ * @brief Lê a lista em bloco e procura um nome com primeiroComNome
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return endereço do registro ou LIST_END
+ */
+int procuraVetorizada(std::string arquivoDaLista, std::string nome)
+{
+    int fd = open(arquivoDaLista.c_str(), O_RDONLY);
+    if (fd < 0)
+        return LIST_END;
+    int end = endOfList(fd);
+    std::vector<char> list(end, 0);                               // The whole list in one read
+    ssize_t length = pread(fd, list.data(), end, 0);
+    close(fd);
+    return length < HEAD_SIZE ? LIST_END : primeiroComNome(list.data(), length, nome);
+}
@@ -0,0 +1,53 @@
+/**
+ * Busca vetorizada de nomes na lista encadeada em disco. Em vez de seguir os ponteiros e copiar o
+ * nome a cada salto, a lista é lida em bloco (ou usada diretamente de um mapeamento) e o campo used
+ * e o nome de cada registro, até o '\0' (o resto do campo pode ter lixo), são comparados com o alvo usando
+ * SSE2 ou AVX2, escolhidos em tempo de execução, com uma versão escalar como alternativa.
+ */
+
+#ifndef busca_h
+#define busca_h
+#include <cstddef>
+#include <string>
+#include <vector>
+
+typedef enum {
+    BUSCA_ESCALAR,
+    BUSCA_SSE2,
+    BUSCA_AVX2,
+    BUSCA_AUTOMATICA      // a melhor disponível na CPU
+} IMPLEMENTACAO_BUSCA;
+
+/**
+ * @brief Implementação usada por BUSCA_AUTOMATICA nesta CPU
+ */
+IMPLEMENTACAO_BUSCA implementacaoBusca();
+
+/**
+ * @brief Endereços, em ordem crescente, dos registros usados cujo nome é igual a nome
+ * @param data bytes da lista a partir do cabeçalho (leitura em bloco ou mapeamento)
+ * @param size quantidade de bytes em data
+ * @param implementacao implementação a ser usada (uma indisponível na CPU cai na escalar)
+ */
+std::vector<int> procuraNomes(const char *data, size_t size, const std::string &nome,
+                              IMPLEMENTACAO_BUSCA implementacao = BUSCA_AUTOMATICA);
+
+/**
+ * @brief Primeiro registro da lista com um nome, como no percurso de adiciona, usando a busca vetorizada.
+ * Se houver mais de um registro com o nome, os ponteiros são seguidos (sem ler nomes) para escolher o primeiro.
+ * Registros fora da lista ficam com used = 0 (remove e adicionaConcorrente garantem isso), então um
+ * único registro usado com o nome pertence à lista.
+ * @param data bytes da lista a partir do cabeçalho
+ * @param size quantidade de bytes em data
+ * @return endereço do registro ou LIST_END
+ */
+int primeiroComNome(const char *data, size_t size, const std::string &nome);
+
+/**
+ * @brief Lê a lista em bloco e procura um nome com primeiroComNome
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return endereço do registro ou LIST_END
+ */
+int procuraVetorizada(std::string arquivoDaLista, std::string nome);
+
+#endif /* busca_h */
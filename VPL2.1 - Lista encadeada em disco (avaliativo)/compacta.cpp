@@ -0,0 +1,82 @@
+/**
+ * Compactação da lista encadeada em disco
+ */
+
+#include "compacta.h"
+#include "lista.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Faz fsync do diretório que contém um arquivo, para que um rename sobreviva a uma queda
+ */
+static void syncParent(const std::string &path)
+{
+    size_t lastSlash = path.find_last_of('/');
+    std::string dir = lastSlash == std::string::npos ? std::string(".") : path.substr(0, lastSlash + 1);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Reescreve a lista com os registros na ordem do percurso, contíguos a partir do cabeçalho,
+ * descartando os registros livres. Um percurso completo passa a ser uma única leitura sequencial.
+ * A nova lista é escrita em "<lista>.tmp" e só então substitui a antiga com rename, de modo que
+ * uma queda no meio deixa a lista antiga intacta. Os arquivos ".idx" e ".livres" são descartados.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return false se a nova lista não pôde ser gravada
+ */
+bool compacta(std::string arquivoDaLista)
+{
+    int fd = open(arquivoDaLista.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    int end = endOfList(fd);
+    std::vector<char> list(end, 0);                               // The whole old list in one read
+    ssize_t length = pread(fd, list.data(), end, 0);
+    close(fd);
+    if (length < HEAD_SIZE)
+        return false;
+
+    // Records in traversal order, relinked to their new consecutive addresses
+    std::vector<REGISTRO> records;
+    int address;
+    memcpy(&address, list.data(), HEAD_SIZE);
+    for (int hops(0); !isListEnd(address) && address + RECORD_SIZE <= length && hops <= end / RECORD_SIZE; hops++) {
+        REGISTRO record;
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        address = record.next;
+        record.next = HEAD_SIZE + static_cast<int>(records.size() + 1) * RECORD_SIZE;
+        records.push_back(record);
+    }
+    if (!records.empty())
+        records.back().next = LIST_END;
+
+    std::vector<char> compacted(HEAD_SIZE + records.size() * RECORD_SIZE);
+    int head = records.empty() ? LIST_END : HEAD_SIZE;
+    memcpy(compacted.data(), &head, HEAD_SIZE);
+    if (!records.empty())
+        memcpy(compacted.data() + HEAD_SIZE, records.data(), records.size() * RECORD_SIZE);
+
+    std::string temporary = arquivoDaLista + ".tmp";
+    int out = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+        return false;
+    bool ok = write(out, compacted.data(), compacted.size()) == (ssize_t) compacted.size() && fsync(out) == 0;
+    close(out);
+    if (!ok || rename(temporary.c_str(), arquivoDaLista.c_str()) < 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    syncParent(arquivoDaLista);
+
+    unlink((arquivoDaLista + ".idx").c_str());                    // Every address changed
+    unlink((arquivoDaLista + ".livres").c_str());
+    unlink((arquivoDaLista + ".cauda").c_str());                  // Its tail would append past a gap
+    return true;
+}
@@ -0,0 +1,19 @@
+/**
+ * Compactação da lista encadeada em disco
+ */
+
+#ifndef compacta_h
+#define compacta_h
+#include <string>
+
+/**
+ * @brief Reescreve a lista com os registros na ordem do percurso, contíguos a partir do cabeçalho,
+ * descartando os registros livres. Um percurso completo passa a ser uma única leitura sequencial.
+ * A nova lista é escrita em "<lista>.tmp" e só então substitui a antiga com rename, de modo que
+ * uma queda no meio deixa a lista antiga intacta. Os arquivos ".idx" e ".livres" são descartados.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return false se a nova lista não pôde ser gravada
+ */
+bool compacta(std::string arquivoDaLista);
+
+#endif /* compacta_h */
@@ -0,0 +1,192 @@
+/**
+ * Inserções concorrentes de vários processos na mesma lista encadeada em disco
+ */
+
+#include "concorrente.h"
+#include "lista.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CONCURRENT_MIN_MAP (1 << 20)
+
+/**
+ * @brief Garante que o mapeamento local cobre [0, needed), acompanhando o crescimento feito por outros processos
+ */
+static bool ensureMapped(LISTA_CONCORRENTE &lista, size_t needed)
+{
+    if (needed <= lista.mapped)
+        return true;
+    size_t mapped = lista.mapped;
+    while (mapped < needed)
+        mapped *= 2;                                              // Bytes past EOF are mapped but never touched
+    void *base = mremap(lista.base, lista.mapped, mapped, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED)
+        return false;
+    lista.base = static_cast<char*>(base);
+    lista.mapped = mapped;
+    return true;
+}
+
+/**
+ * @brief Garante que o arquivo cobre [0, needed). O arquivo cresce dobrando de tamanho, então quase todas as
+ * inserções não fazem chamada de sistema; posix_fallocate nunca encolhe o arquivo, ao contrário de ftruncate.
+ */
+static bool reserveUpTo(LISTA_CONCORRENTE &lista, int needed)
+{
+    int reserved = __atomic_load_n(&lista.tail->reserved, __ATOMIC_ACQUIRE);
+    if (needed <= reserved)
+        return true;
+    int target = std::max(needed, 2 * reserved);
+    if (posix_fallocate(lista.fd, 0, target) != 0)
+        return false;
+    while (reserved < target && !__atomic_compare_exchange_n(&lista.tail->reserved, &reserved, target, false,
+                                                             __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    }
+    return true;
+}
+
+/**
+ * @brief Registro em um endereço, ou NULL se o endereço não é de um registro já escrito
+ */
+static REGISTRO *record(LISTA_CONCORRENTE &lista, int address)
+{
+    if (isListEnd(address) || address >= __atomic_load_n(&lista.tail->tail, __ATOMIC_ACQUIRE) ||
+        !ensureMapped(lista, static_cast<size_t>(address) + RECORD_SIZE))
+        return NULL;
+    return reinterpret_cast<REGISTRO*>(lista.base + address);
+}
+
+/**
+ * @brief Corta o arquivo no final lógico da lista se o espaço além dele foi reservado por este modo. Só é
+ * chamada por quem usa a lista sozinho, com o flock exclusivo de "<lista>.cauda".
+ */
+static void trimReserved(LISTA_CONCORRENTE &lista)
+{
+    struct stat st;
+    if (fstat(lista.fd, &st) < 0)
+        return;
+    if (lista.tail->magic == TAIL_MAGIC && st.st_size == lista.tail->reserved && lista.tail->tail < st.st_size &&
+        ftruncate(lista.fd, lista.tail->tail) == 0)
+        st.st_size = lista.tail->tail;
+    lista.tail->reserved = st.st_size;
+}
+
+/**
+ * @brief Mapeia a lista e o seu contador de final para inserções concorrentes. Cada processo mantém um flock
+ * compartilhado em "<lista>.cauda" enquanto usa a lista; aberturas e fechamentos são serializados por um flock
+ * exclusivo no arquivo da lista.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ */
+bool abreConcorrente(std::string arquivoDaLista, LISTA_CONCORRENTE &lista)
+{
+    lista.base = NULL;
+    lista.tail = NULL;
+    lista.tailFd = -1;
+    lista.fd = open(arquivoDaLista.c_str(), O_RDWR);
+    if (lista.fd >= 0)
+        lista.tailFd = open((arquivoDaLista + ".cauda").c_str(), O_RDWR | O_CREAT, 0644);
+    if (lista.tailFd < 0 || flock(lista.fd, LOCK_EX) < 0) {      // Only one process opens or closes at a time
+        fechaConcorrente(lista);
+        return false;
+    }
+
+    struct stat st;
+    void *tail = fstat(lista.tailFd, &st) < 0 ||
+                 (static_cast<size_t>(st.st_size) < sizeof(CAUDA) && ftruncate(lista.tailFd, sizeof(CAUDA)) < 0) ?
+                 MAP_FAILED : mmap(NULL, sizeof(CAUDA), PROT_READ | PROT_WRITE, MAP_SHARED, lista.tailFd, 0);
+    if (tail != MAP_FAILED) {
+        lista.tail = static_cast<CAUDA*>(tail);
+        // Only a process that uses the list alone can compare the counter with the file: while others insert,
+        // the file is legitimately larger than the counter
+        bool alone = flock(lista.tailFd, LOCK_EX | LOCK_NB) == 0;
+        if (alone)
+            trimReserved(lista);
+        int end = endOfList(lista.fd);
+        if (lista.tail->magic != TAIL_MAGIC || (alone && lista.tail->tail < end)) { // New, or grew by other means
+            __atomic_store_n(&lista.tail->tail, end, __ATOMIC_RELEASE);
+            lista.tail->reserved = end;
+            lista.tail->magic = TAIL_MAGIC;
+        }
+        flock(lista.tailFd, LOCK_SH);                            // Held until fechaConcorrente
+    }
+    flock(lista.fd, LOCK_UN);
+
+    lista.mapped = CONCURRENT_MIN_MAP;
+    void *base = lista.tail == NULL ? MAP_FAILED :
+                 mmap(NULL, lista.mapped, PROT_READ | PROT_WRITE, MAP_SHARED, lista.fd, 0);
+    if (base == MAP_FAILED) {
+        fechaConcorrente(lista);
+        return false;
+    }
+    lista.base = static_cast<char*>(base);
+    return true;
+}
+
+/**
+ * @brief Desfaz os mapeamentos e fecha os arquivos
+ */
+void fechaConcorrente(LISTA_CONCORRENTE &lista)
+{
+    if (lista.tail != NULL && flock(lista.fd, LOCK_EX) == 0) {
+        if (flock(lista.tailFd, LOCK_EX | LOCK_NB) == 0)         // The last one out trims the unused reservation
+            trimReserved(lista);
+        flock(lista.fd, LOCK_UN);
+    }
+    if (lista.base != NULL)
+        munmap(lista.base, lista.mapped);
+    if (lista.tail != NULL)
+        munmap(lista.tail, sizeof(CAUDA));
+    if (lista.tailFd >= 0)
+        close(lista.tailFd);
+    if (lista.fd >= 0)
+        close(lista.fd);
+    lista.base = NULL;
+    lista.tail = NULL;
+    lista.tailFd = -1;
+    lista.fd = -1;
+}
+
+/**
+ * @brief Mesmo efeito de adiciona, seguro com outros processos inserindo na mesma lista
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista ou se o arquivo não pôde crescer
+ */
+bool adicionaConcorrente(LISTA_CONCORRENTE &lista, const std::string &novoNome, const std::string &depoisDesteNome)
+{
+    int head;
+    memcpy(&head, lista.base, HEAD_SIZE);
+    REGISTRO *anchor(NULL);
+    for (REGISTRO *current = record(lista, head); current != NULL;
+         current = record(lista, __atomic_load_n(&current->next, __ATOMIC_ACQUIRE))) {
+        if (sameName(*current, depoisDesteNome)) {
+            anchor = current;
+            break;
+        }
+    }
+    if (anchor == NULL)
+        return false;
+    int anchorAddress = reinterpret_cast<char*>(anchor) - lista.base;
+
+    // Reserve a slot: no other writer will ever touch it
+    int address = __atomic_fetch_add(&lista.tail->tail, RECORD_SIZE, __ATOMIC_ACQ_REL);
+    if (!reserveUpTo(lista, address + RECORD_SIZE) || !ensureMapped(lista, static_cast<size_t>(address) + RECORD_SIZE))
+        return false;
+    REGISTRO *created = reinterpret_cast<REGISTRO*>(lista.base + address);
+    anchor = reinterpret_cast<REGISTRO*>(lista.base + anchorAddress); // The mapping may have moved
+    *created = makeRecord(novoNome, LIST_END);
+    created->used = 0;                                            // Not in the list until the splice below
+
+    // Splice: retry only if another writer linked a record after the same anchor in between
+    int next = __atomic_load_n(&anchor->next, __ATOMIC_ACQUIRE);
+    do {
+        __atomic_store_n(&created->next, next, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&anchor->next, &next, address, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    __atomic_store_n(&created->used, 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,52 @@
+/**
+ * Inserções concorrentes de vários processos na mesma lista encadeada em disco. O endereço de cada
+ * novo registro é reservado com um fetch-add atômico no contador de final de lista, mantido em
+ * "<lista>.cauda" e mapeado com MAP_SHARED por todos os processos. O registro é escrito sem
+ * coordenação na sua posição reservada e apenas a ligação ao anterior é sincronizada, com
+ * compare-and-swap no campo next de 4 bytes. Neste modo nenhum registro é removido, o que descarta
+ * o problema ABA; os registros livres não são reaproveitados. O contador só aumenta: quem substitui
+ * o arquivo da lista (como compacta) deve apagar "<lista>.cauda". O arquivo cresce dobrando de tamanho e
+ * o último processo a fechar a lista corta os registros reservados e não usados.
+ */
+
+#ifndef concorrente_h
+#define concorrente_h
+#include <cstddef>
+#include <string>
+
+#define TAIL_MAGIC 0x4C494154     // "TAIL"
+
+typedef struct {
+    int magic;                    // TAIL_MAGIC depois de inicializado
+    int tail;                     // endereço do próximo registro a ser reservado
+    int reserved;                 // bytes já alocados no arquivo da lista (o arquivo cresce em blocos)
+} CAUDA;
+
+typedef struct {
+    int fd;                       // arquivo da lista
+    int tailFd;                   // arquivo "<lista>.cauda"
+    char *base;                   // lista mapeada com MAP_SHARED
+    size_t mapped;                // bytes mapeados da lista
+    CAUDA *tail;                  // contador compartilhado
+} LISTA_CONCORRENTE;
+
+/**
+ * @brief Mapeia a lista e o seu contador de final para inserções concorrentes
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ */
+bool abreConcorrente(std::string arquivoDaLista, LISTA_CONCORRENTE &lista);
+
+/**
+ * @brief Desfaz os mapeamentos e fecha os arquivos
+ */
+void fechaConcorrente(LISTA_CONCORRENTE &lista);
+
+/**
+ * @brief Mesmo efeito de adiciona, seguro com outros processos inserindo na mesma lista
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista ou se o arquivo não pôde crescer
+ */
+bool adicionaConcorrente(LISTA_CONCORRENTE &lista, const std::string &novoNome, const std::string &depoisDesteNome);
+
+#endif /* concorrente_h */
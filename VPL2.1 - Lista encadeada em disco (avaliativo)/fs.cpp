@@ -1,4 +1,5 @@
 #include "fs.h"
+#include "livres.h"
 #include <fstream>
 
 #define BYTE_NUM 4
@@ -12,20 +13,22 @@
  */
 void adiciona(std::string arquivoDaLista, std::string novoNome, std::string depoisDesteNome)
 {
+    LIVRES freeList;
+    int newAddress = alocaRegistro(arquivoDaLista, freeList); // A removed record, or the end of the file when there is none
+
     std::fstream file(arquivoDaLista, std::ios::in | std::ios::out | std::ios::binary);
     
     auto readIntFromFile = [](std::fstream &file) -> int {
-        char bytes[BYTE_NUM];                      // Array to hold the 4 bytes read from the file
-        file.read(bytes, BYTE_NUM);                // Read 4 bytes from the file into the array
+        unsigned char bytes[BYTE_NUM];             // Array to hold the 4 bytes read from the file (unsigned: no sign extension)
+        file.read(reinterpret_cast<char*>(bytes), BYTE_NUM); // Read 4 bytes from the file into the array
         return (static_cast<int>(bytes[0]) <<  0 | // First byte  (least significant)
                 static_cast<int>(bytes[1]) <<  8 | // Second byte (shifted by 8 bits)
                 static_cast<int>(bytes[2]) << 16 | // Third byte  (shifted by 16 bits)
                 static_cast<int>(bytes[3]) << 24); // Fourth byte (shifted by 24 bits)
     };
                        
-    char start = readIntFromFile(file);            
+    int start = readIntFromFile(file);            
 
-    int newAddress(sizeof(int));                   
     file.seekg(newAddress);                        
     file.write("\1\0\0\0", BYTE_NUM);                 
 
@@ -45,9 +48,10 @@ void adiciona(std::string arquivoDaLista, std::string novoNome, std::string depo
 
     writeIntToFile(file, 0);                       
 
-    bool nameFound;
+    bool nameFound(false);
     int foundRegisterAddress = start;              
-    while (!nameFound) {                           // Loop until the name is found
+    file.seekg(start);                             // Cursor goes to the first register
+    while (!nameFound && foundRegisterAddress >= BYTE_NUM && file) { // Loop until the name is found or the list ends
         bool state = readIntFromFile(file);        
         file.read(name, NAME_SIZE);                // Read the name of the register         
         if (name == depoisDesteNome)               // If the name is the one we are looking for
@@ -59,6 +63,15 @@ void adiciona(std::string arquivoDaLista, std::string novoNome, std::string depo
         }
     }
 
+    if (!nameFound) {                              // The new register is not linked: leave it free
+        file.clear();
+        file.seekp(newAddress);
+        file.write("\0\0\0\0", BYTE_NUM);
+        file.close();
+        confirmaRegistro(arquivoDaLista, freeList, newAddress, false);
+        return;
+    }
+
     file.seekg(foundRegisterAddress + REG_SIZE);
     int addr = readIntFromFile(file);
     file.seekg(foundRegisterAddress + REG_SIZE);
@@ -67,4 +80,5 @@ void adiciona(std::string arquivoDaLista, std::string novoNome, std::string depo
     writeIntToFile(file, addr);
 
     file.close();
+    confirmaRegistro(arquivoDaLista, freeList, newAddress, true); // Stamped after the writes above
 }
\ No newline at end of file
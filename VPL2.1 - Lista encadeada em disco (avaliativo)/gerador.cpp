@@ -0,0 +1,68 @@
+/**
+ * Geração de listas grandes para testes e medições
+ */
+
+#include "gerador.h"
+#include "lista.h"
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <numeric>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#define CHUNK_RECORDS 65536   // Records written per pwrite
+
+/**
+ * @brief Nome do registro na posição i do percurso de uma lista gerada
+ */
+std::string nomeGerado(int i)
+{
+    return "n" + std::to_string(i);
+}
+
+/**
+ * @brief Grava uma lista com registros nomeados nomeGerado(0) ... nomeGerado(registros - 1), nessa ordem
+ * de percurso. Na disposição sequencial o registro i ocupa a posição física i; na embaralhada as
+ * posições são uma permutação aleatória, de modo que cada salto cai em um ponto qualquer do arquivo.
+ * @param arquivoDaLista nome do arquivo em disco a ser criado (ou substituído)
+ * @param registros quantidade de registros
+ * @param embaralhada true para a disposição embaralhada
+ * @param semente semente do embaralhamento
+ * @return true se a lista foi gravada
+ */
+bool geraLista(std::string arquivoDaLista, int registros, bool embaralhada, unsigned semente)
+{
+    if (registros < 0 || registros > (INT_MAX - HEAD_SIZE) / RECORD_SIZE)
+        return false;
+
+    std::vector<int> slot(registros);                             // Physical slot of the i-th record of the traversal
+    std::iota(slot.begin(), slot.end(), 0);
+    if (embaralhada)
+        std::shuffle(slot.begin(), slot.end(), std::mt19937(semente));
+    std::vector<int> position(registros);                         // Traversal position of the record in each slot
+    for (int i(0); i < registros; i++)
+        position[slot[i]] = i;
+
+    int fd = open(arquivoDaLista.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    int head = registros ? HEAD_SIZE + slot[0] * RECORD_SIZE : LIST_END;
+    bool ok = pwrite(fd, &head, HEAD_SIZE, 0) == HEAD_SIZE;
+
+    // Records are produced in physical order so the file is written sequentially
+    std::vector<REGISTRO> chunk;
+    chunk.reserve(CHUNK_RECORDS);
+    for (int first(0); ok && first < registros; first += CHUNK_RECORDS) {
+        chunk.clear();
+        for (int s(first); s < std::min(registros, first + CHUNK_RECORDS); s++) {
+            int i = position[s];
+            chunk.push_back(makeRecord(nomeGerado(i), i + 1 < registros ? HEAD_SIZE + slot[i + 1] * RECORD_SIZE : LIST_END));
+        }
+        ssize_t size = chunk.size() * RECORD_SIZE;
+        ok = pwrite(fd, chunk.data(), size, HEAD_SIZE + static_cast<off_t>(first) * RECORD_SIZE) == size;
+    }
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,26 @@
+/**
+ * Geração de listas grandes para testes e medições
+ */
+
+#ifndef gerador_h
+#define gerador_h
+#include <string>
+
+/**
+ * @brief Nome do registro na posição i do percurso de uma lista gerada
+ */
+std::string nomeGerado(int i);
+
+/**
+ * @brief Grava uma lista com registros nomeados nomeGerado(0) ... nomeGerado(registros - 1), nessa ordem
+ * de percurso. Na disposição sequencial o registro i ocupa a posição física i; na embaralhada as
+ * posições são uma permutação aleatória, de modo que cada salto cai em um ponto qualquer do arquivo.
+ * @param arquivoDaLista nome do arquivo em disco a ser criado (ou substituído)
+ * @param registros quantidade de registros
+ * @param embaralhada true para a disposição embaralhada
+ * @param semente semente do embaralhamento
+ * @return true se a lista foi gravada
+ */
+bool geraLista(std::string arquivoDaLista, int registros, bool embaralhada, unsigned semente = 1);
+
+#endif /* gerador_h */
@@ -0,0 +1,296 @@
+/**
+ * Índice persistente (hash com endereçamento aberto) da lista encadeada em disco
+ */
+
+#include "indice.h"
+#include "lista.h"
+#include "livres.h"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define INDEX_MAGIC 0x5844494C   // "LIDX"
+#define INDEX_MIN_CAPACITY 16
+#define PROBE_RUN 8              // Slots fetched per read while probing
+
+typedef struct {
+    int magic;
+    int capacity;                // potência de 2
+    int count;                   // nomes no índice
+    int listSize;                // tamanho da lista quando o índice foi sincronizado
+    long modifiedSec;            // data de modificação da lista quando o índice foi sincronizado
+    long modifiedNsec;
+} INDEX_HEADER;
+
+typedef struct {
+    char name[NAME_SIZE];
+    int address;                 // 0 = slot vazio
+} INDEX_SLOT;
+
+typedef struct {
+    int listFd;
+    int fd;
+    INDEX_HEADER header;
+} INDICE;
+
+/**
+ * @brief FNV-1a sobre os 20 bytes do nome
+ */
+static unsigned int hashName(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    for (int i(0); i < NAME_SIZE; i++) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static off_t slotOffset(int slot)
+{
+    return sizeof(INDEX_HEADER) + static_cast<off_t>(slot) * sizeof(INDEX_SLOT);
+}
+
+/**
+ * @brief Grava no cabeçalho o tamanho e a data de modificação atuais da lista
+ */
+static void stampHeader(int listFd, INDEX_HEADER &header)
+{
+    struct stat st;
+    bool ok = fstat(listFd, &st) == 0;
+    header.listSize = ok ? static_cast<int>(st.st_size) : -1;
+    header.modifiedSec = ok ? static_cast<long>(st.st_mtim.tv_sec) : 0;
+    header.modifiedNsec = ok ? static_cast<long>(st.st_mtim.tv_nsec) : 0;
+}
+
+/**
+ * @brief Coloca um nome em uma tabela em memória (usado na reconstrução)
+ */
+static void placeSlot(std::vector<INDEX_SLOT> &slots, const INDEX_SLOT &slot)
+{
+    int mask = slots.size() - 1;
+    for (int i = hashName(slot.name) & mask;; i = (i + 1) & mask) {
+        if (slots[i].address == 0) {
+            slots[i] = slot;
+            return;
+        }
+        if (memcmp(slots[i].name, slot.name, NAME_SIZE) == 0)  // Duplicate name: the first one in list order wins
+            return;
+    }
+}
+
+/**
+ * @brief Percorre a lista e grava um índice novo com capacidade para pelo menos o dobro dos nomes
+ */
+static bool rebuild(INDICE &index, int minCount)
+{
+    INDEX_HEADER header{INDEX_MAGIC, 0, 0, 0, 0, 0};
+    stampHeader(index.listFd, header);
+    int size = header.listSize;
+    if (size < HEAD_SIZE)
+        return false;
+    std::vector<char> list(size);                                // The whole list in one read
+    if (pread(index.listFd, list.data(), size, 0) != size)
+        return false;
+
+    std::vector<INDEX_SLOT> entries;
+    int address;
+    memcpy(&address, list.data(), HEAD_SIZE);
+    for (int hops(0); !isListEnd(address) && address + RECORD_SIZE <= size && hops <= size / RECORD_SIZE; hops++) {
+        REGISTRO record;
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        INDEX_SLOT slot;
+        memset(slot.name, 0, NAME_SIZE);
+        strncpy(slot.name, record.name, NAME_SIZE);              // Garbage after the terminator is not part of the key
+        slot.address = address;
+        entries.push_back(slot);
+        address = record.next;
+    }
+
+    int capacity(INDEX_MIN_CAPACITY);
+    while (capacity < 2 * std::max<int>(entries.size(), minCount))
+        capacity *= 2;
+    std::vector<INDEX_SLOT> slots(capacity, INDEX_SLOT{{0}, 0});
+    for (const INDEX_SLOT &slot : entries)
+        placeSlot(slots, slot);
+
+    header.capacity = capacity;
+    index.header = header;
+    for (const INDEX_SLOT &slot : slots)
+        index.header.count += slot.address != 0;
+    ssize_t length = slots.size() * sizeof(INDEX_SLOT);
+    return ftruncate(index.fd, 0) == 0 &&
+           pwrite(index.fd, &index.header, sizeof(INDEX_HEADER), 0) == sizeof(INDEX_HEADER) &&
+           pwrite(index.fd, slots.data(), length, sizeof(INDEX_HEADER)) == length;
+}
+
+/**
+ * @brief Abre a lista e o seu índice, reconstruindo o índice se estiver ausente ou se a lista foi alterada
+ * (tamanho ou data de modificação) por quem não mantém o índice
+ */
+static bool openIndex(const std::string &arquivoDaLista, INDICE &index)
+{
+    index.listFd = open(arquivoDaLista.c_str(), O_RDWR);
+    index.fd = index.listFd < 0 ? -1 : open((arquivoDaLista + ".idx").c_str(), O_RDWR | O_CREAT, 0644);
+    if (index.fd < 0)
+        return false;
+    INDEX_HEADER current;
+    stampHeader(index.listFd, current);
+    if (pread(index.fd, &index.header, sizeof(INDEX_HEADER), 0) != sizeof(INDEX_HEADER) ||
+        index.header.magic != INDEX_MAGIC || index.header.listSize != current.listSize ||
+        index.header.modifiedSec != current.modifiedSec || index.header.modifiedNsec != current.modifiedNsec)
+        return rebuild(index, 0);
+    return true;
+}
+
+static void closeIndex(INDICE &index)
+{
+    if (index.fd >= 0)
+        close(index.fd);
+    if (index.listFd >= 0)
+        close(index.listFd);
+}
+
+/**
+ * @brief Procura um nome no índice
+ * @param slot recebe o slot do nome ou o primeiro slot vazio da sequência de sondagem
+ * @return endereço do registro ou LIST_END
+ */
+static int probe(INDICE &index, const char *name, int &slot)
+{
+    int mask = index.header.capacity - 1;
+    INDEX_SLOT run[PROBE_RUN];
+    for (int first = hashName(name) & mask, done(0); done < index.header.capacity;) {
+        int count = std::min(PROBE_RUN, index.header.capacity - first); // Runs stop at the end of the table
+        if (pread(index.fd, run, count * sizeof(INDEX_SLOT), slotOffset(first)) != (ssize_t) (count * sizeof(INDEX_SLOT)))
+            return LIST_END;
+        for (int i(0); i < count; i++) {
+            if (run[i].address == 0 || memcmp(run[i].name, name, NAME_SIZE) == 0) {
+                slot = first + i;
+                return run[i].address == 0 ? LIST_END : run[i].address;
+            }
+        }
+        done += count;
+        first = (first + count) & mask;
+    }
+    slot = -1;
+    return LIST_END;
+}
+
+/**
+ * @brief Indica se a lista foi escrita há pouco: outra escrita no mesmo tique do relógio de arquivos (que pode
+ * ser grosso) não mudaria a data de modificação, e o carimbo do índice não a detectaria
+ */
+static bool recentlyWritten(const INDEX_HEADER &header)
+{
+    return time(NULL) <= header.modifiedSec + 1;
+}
+
+/**
+ * @brief Procura um nome, conferindo o registro apontado e reconstruindo o índice uma vez se ele estiver desatualizado.
+ * O índice aberto está sincronizado com a lista, então um slot vazio é uma ausência definitiva, exceto logo depois
+ * de uma escrita na lista, quando a ausência é conferida com uma reconstrução.
+ * @param record recebe o registro encontrado
+ */
+static int lookup(INDICE &index, const std::string &nome, REGISTRO &record)
+{
+    REGISTRO key = makeRecord(nome, 0);
+    for (int attempt(0); attempt < 2; attempt++) {
+        int slot;
+        int address = probe(index, key.name, slot);
+        if (address == LIST_END) {
+            if (attempt == 0 && recentlyWritten(index.header) && rebuild(index, 0))
+                continue;
+            break;
+        }
+        if (readRecord(index.listFd, address, record) && record.used && sameName(record, nome))
+            return address;
+        if (attempt == 0 && !rebuild(index, 0))                   // A hit that fails validation: the entry is stale
+            break;
+    }
+    return LIST_END;
+}
+
+/**
+ * @brief Reconstrói o índice a partir de um percurso da lista
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return true se o índice foi gravado
+ */
+bool reconstroiIndice(std::string arquivoDaLista)
+{
+    INDICE index;
+    bool ok = openIndex(arquivoDaLista, index) && rebuild(index, 0);
+    closeIndex(index);
+    return ok;
+}
+
+/**
+ * @brief Endereço do registro com um nome, consultando o índice (que é reconstruído se estiver ausente ou desatualizado)
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param nome nome procurado
+ * @return endereço do registro ou LIST_END se o nome não estiver na lista
+ */
+int procuraIndexado(std::string arquivoDaLista, std::string nome)
+{
+    INDICE index;
+    REGISTRO record;
+    int address = openIndex(arquivoDaLista, index) ? lookup(index, nome, record) : LIST_END;
+    closeIndex(index);
+    return address;
+}
+
+/**
+ * @brief Mesmo efeito de adiciona, localizando depoisDesteNome pelo índice e mantendo o índice atualizado.
+ * O novo registro ocupa um registro livre ou é gravado ao final do arquivo.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista
+ */
+bool adicionaIndexado(std::string arquivoDaLista, std::string novoNome, std::string depoisDesteNome)
+{
+    INDICE index;
+    if (!openIndex(arquivoDaLista, index)) {
+        closeIndex(index);
+        return false;
+    }
+
+    REGISTRO anchor;
+    int anchorAddress = lookup(index, depoisDesteNome, anchor);
+    if (anchorAddress == LIST_END) {
+        closeIndex(index);
+        return false;
+    }
+
+    if (2 * (index.header.count + 1) > index.header.capacity)    // Keep the load factor at most 1/2
+        rebuild(index, index.header.count + 1);
+
+    // New record first, then the anchor's pointer: a crash in between leaves the list intact
+    LIVRES freeList;
+    bool haveFreeList = openFreeList(arquivoDaLista, index.listFd, freeList);
+    int newAddress = haveFreeList ? takeFreeRecord(index.listFd, freeList) : endOfList(index.listFd); // Reuse before growing
+    REGISTRO record = makeRecord(novoNome, anchor.next);
+    bool ok = writeRecord(index.listFd, newAddress, record) && writeNext(index.listFd, anchorAddress, newAddress);
+    if (haveFreeList)
+        closeFreeList(freeList, index.listFd);
+
+    int slot(-1);
+    REGISTRO existing;
+    int found = ok ? probe(index, record.name, slot) : LIST_END;
+    bool stale = found != LIST_END && !(readRecord(index.listFd, found, existing) && existing.used && sameName(existing, novoNome));
+    if (ok && slot >= 0 && (found == LIST_END || stale)) {        // A removed name's slot is taken over
+        INDEX_SLOT entry;
+        memcpy(entry.name, record.name, NAME_SIZE);
+        entry.address = newAddress;
+        index.header.count += found == LIST_END;
+        pwrite(index.fd, &entry, sizeof(INDEX_SLOT), slotOffset(slot));
+    }
+    stampHeader(index.listFd, index.header);                      // After the last write to the list
+    pwrite(index.fd, &index.header, sizeof(INDEX_HEADER), 0);
+    closeIndex(index);
+    return ok;
+}
@@ -0,0 +1,37 @@
+/**
+ * Índice persistente da lista encadeada em disco: uma tabela hash com endereçamento aberto, gravada
+ * em "<lista>.idx", que leva um nome de 20 bytes ao endereço do seu registro. Com o índice, uma
+ * inserção após um nome faz um número constante de leituras e escritas, qualquer que seja o
+ * tamanho da lista.
+ */
+
+#ifndef indice_h
+#define indice_h
+#include <string>
+
+/**
+ * @brief Reconstrói o índice a partir de um percurso da lista
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @return true se o índice foi gravado
+ */
+bool reconstroiIndice(std::string arquivoDaLista);
+
+/**
+ * @brief Endereço do registro com um nome, consultando o índice (que é reconstruído se estiver ausente ou desatualizado)
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param nome nome procurado
+ * @return endereço do registro ou LIST_END se o nome não estiver na lista
+ */
+int procuraIndexado(std::string arquivoDaLista, std::string nome);
+
+/**
+ * @brief Mesmo efeito de adiciona, localizando depoisDesteNome pelo índice e mantendo o índice atualizado.
+ * O novo registro ocupa um registro livre ou é gravado ao final do arquivo.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista
+ */
+bool adicionaIndexado(std::string arquivoDaLista, std::string novoNome, std::string depoisDesteNome);
+
+#endif /* indice_h */
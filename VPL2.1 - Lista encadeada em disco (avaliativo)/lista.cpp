@@ -0,0 +1,80 @@
+/**
+ * Acesso aos registros do arquivo da lista encadeada em disco
+ */
+
+#include "lista.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Monta um registro usado com o nome completado com zeros
+ * @param name nome do registro (até NAME_SIZE caracteres)
+ * @param next endereço do próximo registro
+ */
+REGISTRO makeRecord(const std::string &name, int next)
+{
+    REGISTRO record;
+    record.used = 1;
+    memset(record.name, 0, NAME_SIZE);
+    memcpy(record.name, name.data(), std::min<size_t>(name.size(), NAME_SIZE));
+    record.next = next;
+    return record;
+}
+
+/**
+ * @brief Compara o nome de um registro com um nome
+ */
+bool sameName(const REGISTRO &record, const std::string &name)
+{
+    size_t length = strnlen(record.name, NAME_SIZE);
+    return length == name.size() && memcmp(record.name, name.data(), length) == 0;
+}
+
+/**
+ * @brief Lê o endereço do primeiro registro
+ * @param fd descritor de arquivo aberto da lista
+ */
+bool readHead(int fd, int &head)
+{
+    return pread(fd, &head, HEAD_SIZE, 0) == HEAD_SIZE;
+}
+
+/**
+ * @brief Lê um registro inteiro
+ * @param address endereço do registro no arquivo
+ */
+bool readRecord(int fd, int address, REGISTRO &record)
+{
+    return !isListEnd(address) && pread(fd, &record, RECORD_SIZE, address) == RECORD_SIZE;
+}
+
+/**
+ * @brief Escreve um registro inteiro
+ * @param address endereço do registro no arquivo
+ */
+bool writeRecord(int fd, int address, const REGISTRO &record)
+{
+    return !isListEnd(address) && pwrite(fd, &record, RECORD_SIZE, address) == RECORD_SIZE;
+}
+
+/**
+ * @brief Escreve apenas o campo next de um registro
+ * @param address endereço do registro no arquivo
+ */
+bool writeNext(int fd, int address, int next)
+{
+    return !isListEnd(address) && pwrite(fd, &next, sizeof(int), address + REG_SIZE) == sizeof(int);
+}
+
+/**
+ * @brief Endereço do primeiro registro depois do último registro do arquivo
+ */
+int endOfList(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < HEAD_SIZE)
+        return HEAD_SIZE;
+    return HEAD_SIZE + (st.st_size - HEAD_SIZE + RECORD_SIZE - 1) / RECORD_SIZE * RECORD_SIZE; // Round up a torn tail
+}
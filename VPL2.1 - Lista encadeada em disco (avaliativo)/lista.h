@@ -0,0 +1,74 @@
+/**
+ * Formato do arquivo da lista encadeada em disco: um inteiro de 4 bytes com o endereço do primeiro
+ * registro, seguido de registros de 28 bytes (usado, nome, próximo). Um endereço menor que o
+ * cabeçalho (ex.: 0xffffffe8) termina a lista.
+ */
+
+#ifndef lista_h
+#define lista_h
+#include <string>
+
+#define HEAD_SIZE 4
+#define NAME_SIZE 20
+#define REG_SIZE 24          // Offset of the next field inside a record
+#define RECORD_SIZE 28
+#define LIST_END -1
+
+typedef struct {
+    int used;                // 1 se o registro pertence à lista
+    char name[NAME_SIZE];    // nome completado com zeros
+    int next;                // endereço do próximo registro
+} REGISTRO;
+
+static_assert(sizeof(REGISTRO) == RECORD_SIZE, "REGISTRO must match the on-disk record");
+
+/**
+ * @brief Indica se um endereço termina a lista
+ */
+inline bool isListEnd(int address)
+{
+    return address < HEAD_SIZE;
+}
+
+/**
+ * @brief Monta um registro usado com o nome completado com zeros
+ * @param name nome do registro (até NAME_SIZE caracteres)
+ * @param next endereço do próximo registro
+ */
+REGISTRO makeRecord(const std::string &name, int next);
+
+/**
+ * @brief Compara o nome de um registro com um nome
+ */
+bool sameName(const REGISTRO &record, const std::string &name);
+
+/**
+ * @brief Lê o endereço do primeiro registro
+ * @param fd descritor de arquivo aberto da lista
+ */
+bool readHead(int fd, int &head);
+
+/**
+ * @brief Lê um registro inteiro
+ * @param address endereço do registro no arquivo
+ */
+bool readRecord(int fd, int address, REGISTRO &record);
+
+/**
+ * @brief Escreve um registro inteiro
+ * @param address endereço do registro no arquivo
+ */
+bool writeRecord(int fd, int address, const REGISTRO &record);
+
+/**
+ * @brief Escreve apenas o campo next de um registro
+ * @param address endereço do registro no arquivo
+ */
+bool writeNext(int fd, int address, int next);
+
+/**
+ * @brief Endereço do primeiro registro depois do último registro do arquivo
+ */
+int endOfList(int fd);
+
+#endif /* lista_h */
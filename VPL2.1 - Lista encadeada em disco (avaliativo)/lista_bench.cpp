@@ -0,0 +1,157 @@
+/**
+ * Mede a vazão das inserções na lista encadeada em disco sobre listas geradas com geraLista
+ */
+
+#include "fs.h"
+#include "gerador.h"
+#include "compacta.h"
+#include "indice.h"
+#include "lista.h"
+#include "mapa.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s <records> [--shuffled] [--ops <n>] [--engine <name>] [--file <list>] [--seed <n>]\n", program);
+    fprintf(stderr, "  --shuffled       random physical layout (default: sequential)\n");
+    fprintf(stderr, "  --ops <n>        inserts per workload (default: 1000)\n");
+    fprintf(stderr, "  --engine <name>  adiciona, indexado or mapeada (default: indexado)\n");
+    fprintf(stderr, "  --file <list>    list file to generate (default: lista-bench.bin)\n");
+}
+
+typedef struct {
+    unsigned long long bytesRead;   // rchar of /proc/self/io: bytes returned by read/pread
+    long faults;                    // page faults, which is how mmap reads show up
+} IO_COUNTERS;
+
+static IO_COUNTERS ioCounters()
+{
+    IO_COUNTERS counters{0, 0};
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    unsigned long long value;
+    while (io >> key >> value)
+        if (key == "rchar:")
+            counters.bytesRead = value;
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        counters.faults = usage.ru_minflt + usage.ru_majflt;
+    return counters;
+}
+
+static void removeList(const std::string &file)
+{
+    unlink(file.c_str());
+    unlink((file + ".idx").c_str());
+    unlink((file + ".livres").c_str());
+    unlink((file + ".cauda").c_str());
+}
+
+/**
+ * @brief Executa ops inserções, cada uma depois do nome devolvido por anchor, e imprime uma linha da tabela
+ */
+static bool runWorkload(const char *name, const std::string &engine, const std::string &file, int ops,
+                        const std::function<std::string()> &anchor)
+{
+    LISTA_MAPEADA lista;
+    if (engine == "indexado")
+        reconstroiIndice(file);                                   // Built once, outside the measurement
+    else if (engine == "mapeada" && !abreMapeada(file, lista))
+        return false;
+
+    bool ok(true);
+    IO_COUNTERS before = ioCounters();
+    auto start = std::chrono::steady_clock::now();
+    for (int i(0); ok && i < ops; i++) {
+        std::string novoNome = "b" + std::to_string(i);
+        if (engine == "adiciona")
+            adiciona(file, novoNome, anchor());
+        else if (engine == "indexado")
+            ok = adicionaIndexado(file, novoNome, anchor());
+        else
+            ok = adicionaMapeada(lista, novoNome, anchor());
+    }
+    if (engine == "mapeada")
+        fechaMapeada(lista);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    IO_COUNTERS after = ioCounters();
+
+    printf("%-8s %8d %12.0f %14.0f %10.2f\n", name, ops, ops / seconds,
+           static_cast<double>(after.bytesRead - before.bytesRead) / ops, static_cast<double>(after.faults - before.faults) / ops);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || atoi(argv[1]) <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int records = atoi(argv[1]);
+    bool shuffled(false);
+    int ops(1000);
+    unsigned seed(1);
+    std::string engine("indexado");
+    std::string file("lista-bench.bin");
+    for (int i(2); i < argc; i++) {
+        if (strcmp(argv[i], "--shuffled") == 0)
+            shuffled = true;
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+            ops = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+            engine = argv[++i];
+        else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+            file = argv[++i];
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoul(argv[++i], NULL, 10);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (engine != "adiciona" && engine != "indexado" && engine != "mapeada") {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("%d records, %s layout, engine %s\n", records, shuffled ? "shuffled" : "sequential", engine.c_str());
+    printf("%-8s %8s %12s %14s %10s\n", "workload", "ops", "ops/s", "bytes read/op", "faults/op");
+
+    std::mt19937 rng(seed);
+    std::string head = nomeGerado(0);
+    std::string tail = nomeGerado(records - 1);
+    struct {
+        const char *name;
+        std::function<std::string()> anchor;
+    } workloads[] = {
+        {"head", [&]() { return head; }},
+        {"tail", [&]() { return tail; }},
+        {"random", [&]() { return nomeGerado(rng() % records); }},
+    };
+
+    bool ok(true);
+    for (auto &workload : workloads) {
+        removeList(file);
+        if (!geraLista(file, records, shuffled, seed)) {            // Every workload starts from the same list
+            fprintf(stderr, "cannot write %s\n", file.c_str());
+            return 1;
+        }
+        ok = runWorkload(workload.name, engine, file, ops, workload.anchor) && ok;
+    }
+
+    // The list left by the random workload is the most scattered one
+    auto start = std::chrono::steady_clock::now();
+    ok = compacta(file) && ok;
+    printf("compacta %.1f ms\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    removeList(file);
+    return ok ? 0 : 1;
+}
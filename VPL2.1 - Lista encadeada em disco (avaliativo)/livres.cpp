@@ -0,0 +1,224 @@
+/**
+ * Remoção e reaproveitamento de registros da lista encadeada em disco
+ */
+
+#include "livres.h"
+#include "lista.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief Refaz a lista de livres encadeando todos os registros com used = 0, em ordem de endereço
+ * @param end final lógico da lista: o espaço depois dele (ex.: crescimento de um mapeamento) não tem registros
+ */
+static bool rebuildFreeList(int listFd, LIVRES &freeList, int end)
+{
+    std::vector<char> list(end, 0);                               // The whole list in one read
+    if (pread(listFd, list.data(), end, 0) < HEAD_SIZE)
+        return false;
+
+    freeList.head = LIST_END;
+    for (int address = end - RECORD_SIZE; address >= HEAD_SIZE; address -= RECORD_SIZE) {
+        REGISTRO record;
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        if (record.used != 0)
+            continue;
+        if (record.next != freeList.head && !writeNext(listFd, address, freeList.head))
+            return false;
+        freeList.head = address;
+    }
+    return true;
+}
+
+/**
+ * @brief Tamanho e data de modificação atuais da lista
+ */
+static LIVRES_HEADER listStamp(int listFd, int head)
+{
+    struct stat st;
+    if (fstat(listFd, &st) < 0)
+        return LIVRES_HEADER{-1, 0, 0, head};
+    return LIVRES_HEADER{static_cast<long>(st.st_size), static_cast<long>(st.st_mtim.tv_sec),
+                         static_cast<long>(st.st_mtim.tv_nsec), head};
+}
+
+/**
+ * @brief Abre a lista de registros livres de uma lista
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param listFd descritor de arquivo aberto da lista
+ */
+bool openFreeList(const std::string &arquivoDaLista, int listFd, LIVRES &freeList)
+{
+    freeList.head = LIST_END;
+    freeList.fd = open((arquivoDaLista + ".livres").c_str(), O_RDWR | O_CREAT, 0644);
+    if (freeList.fd < 0)
+        return false;
+    LIVRES_HEADER header;
+    LIVRES_HEADER current = listStamp(listFd, LIST_END);
+    if (pread(freeList.fd, &header, sizeof(header), 0) != sizeof(header) || header.size != current.size ||
+        header.modifiedSec != current.modifiedSec || header.modifiedNsec != current.modifiedNsec)
+        return rebuildFreeList(listFd, freeList, endOfList(listFd)); // Missing, or the list was written by someone else
+    freeList.head = header.head;
+    return true;
+}
+
+/**
+ * @brief Retira um registro da lista de livres
+ * @param end final lógico da lista, ou -1 para o final do arquivo
+ * @return endereço do registro ou o final da lista se não houver registro livre
+ */
+int takeFreeRecord(int listFd, LIVRES &freeList, int end)
+{
+    if (end < 0)
+        end = endOfList(listFd);
+    for (int attempt(0); attempt < 2; attempt++) {
+        if (isListEnd(freeList.head))
+            return end;
+
+        REGISTRO record;
+        if (readRecord(listFd, freeList.head, record) && record.used == 0) {
+            int address = freeList.head;
+            freeList.head = record.next;
+            return address;
+        }
+        if (!rebuildFreeList(listFd, freeList, end))              // The head was reused behind our back
+            break;
+    }
+    return end;
+}
+
+/**
+ * @brief Marca um registro como livre e o coloca no início da lista de livres
+ */
+bool putFreeRecord(int listFd, LIVRES &freeList, int address)
+{
+    REGISTRO record;
+    if (!readRecord(listFd, address, record))
+        return false;
+    record.used = 0;
+    record.next = freeList.head;
+    if (!writeRecord(listFd, address, record))
+        return false;
+    freeList.head = address;
+    return true;
+}
+
+/**
+ * @brief Grava o início da lista de livres e fecha o arquivo ".livres". Deve ser chamada depois da
+ * última escrita na lista, para que a data de modificação gravada seja a final.
+ * @param listFd descritor de arquivo aberto da lista
+ */
+void closeFreeList(LIVRES &freeList, int listFd)
+{
+    if (freeList.fd < 0)
+        return;
+    LIVRES_HEADER header = listStamp(listFd, freeList.head);
+    pwrite(freeList.fd, &header, sizeof(header), 0);
+    close(freeList.fd);
+    freeList.fd = -1;
+}
+
+/**
+ * @brief Endereço onde o próximo registro deve ser escrito: um registro livre ou o final do arquivo.
+ * A lista de livres fica aberta até confirmaRegistro, chamada depois da escrita do registro.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param freeList recebe a lista de livres aberta
+ */
+int alocaRegistro(std::string arquivoDaLista, LIVRES &freeList)
+{
+    freeList.fd = -1;
+    freeList.head = LIST_END;
+    int listFd = open(arquivoDaLista.c_str(), O_RDWR);
+    if (listFd < 0)
+        return LIST_END;
+
+    int address(0);
+    if (openFreeList(arquivoDaLista, listFd, freeList))
+        address = takeFreeRecord(listFd, freeList);
+    else {
+        if (freeList.fd >= 0)                                     // A partly rebuilt free list is not recorded
+            close(freeList.fd);
+        freeList.fd = -1;
+        address = endOfList(listFd);
+    }
+    close(listFd);
+    return address;
+}
+
+/**
+ * @brief Fecha a lista de livres aberta por alocaRegistro, depois que o registro alocado foi escrito,
+ * para que a data de modificação gravada seja a final
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param address registro devolvido por alocaRegistro
+ * @param linked false se o registro não foi ligado à lista: ele volta para a lista de livres
+ */
+void confirmaRegistro(std::string arquivoDaLista, LIVRES &freeList, int address, bool linked)
+{
+    int listFd = open(arquivoDaLista.c_str(), O_RDWR);
+    if (listFd < 0) {
+        if (freeList.fd >= 0)
+            close(freeList.fd);
+        freeList.fd = -1;
+        return;
+    }
+    if (!linked && freeList.fd >= 0)
+        putFreeRecord(listFd, freeList, address);
+    closeFreeList(freeList, listFd);
+    close(listFd);
+}
+
+/**
+ * @brief Remove da lista o primeiro registro com um nome e o coloca na lista de livres
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param nome nome a ser removido
+ * @return false se o nome não está na lista
+ */
+bool remove(std::string arquivoDaLista, std::string nome)
+{
+    int listFd = open(arquivoDaLista.c_str(), O_RDWR);
+    if (listFd < 0)
+        return false;
+
+    int end = endOfList(listFd);
+    std::vector<char> list(end, 0);                               // The whole list in one read
+    ssize_t length = pread(listFd, list.data(), end, 0);
+
+    // Find the record and its predecessor (LIST_END when it is the first one)
+    int previous(LIST_END);
+    int address(LIST_END);
+    REGISTRO record;
+    if (length >= HEAD_SIZE)
+        memcpy(&address, list.data(), HEAD_SIZE);
+    for (int hops(0); !isListEnd(address) && address + RECORD_SIZE <= length && hops <= end / RECORD_SIZE; hops++) {
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        if (sameName(record, nome))
+            break;
+        previous = address;
+        address = record.next;
+    }
+    if (isListEnd(address) || address + RECORD_SIZE > length || !sameName(record, nome)) {
+        close(listFd);
+        return false;
+    }
+
+    // Unlink first, then free: a crash in between only leaks the record until the next rebuild. The free
+    // list is opened before either write, so its stamp is still current and it need not be rebuilt.
+    LIVRES freeList;
+    bool haveFreeList = openFreeList(arquivoDaLista, listFd, freeList);
+    bool ok = isListEnd(previous) ? pwrite(listFd, &record.next, HEAD_SIZE, 0) == HEAD_SIZE
+                                  : writeNext(listFd, previous, record.next);
+    int unused(0);
+    if (ok && haveFreeList)
+        ok = putFreeRecord(listFd, freeList, address);
+    else if (ok)                                                  // No free list: the next rebuild collects it
+        ok = pwrite(listFd, &unused, sizeof(int), address) == sizeof(int);
+    if (haveFreeList)
+        closeFreeList(freeList, listFd);
+    else if (freeList.fd >= 0)
+        close(freeList.fd);
+    close(listFd);
+    return ok;
+}
@@ -0,0 +1,76 @@
+/**
+ * Remoção e reaproveitamento de registros da lista encadeada em disco. Um registro removido fica com
+ * used = 0 e o seu next passa a encadear a lista de registros livres, cujo primeiro endereço é
+ * gravado em "<lista>.livres" junto com o tamanho e a data de modificação da lista. As inserções
+ * usam um registro livre antes de aumentar o arquivo. Se o arquivo ".livres" estiver ausente ou se
+ * a lista foi alterada por outro meio, a lista de livres é refeita a partir dos registros com used = 0.
+ */
+
+#ifndef livres_h
+#define livres_h
+#include <string>
+
+typedef struct {
+    long size;           // tamanho da lista quando o arquivo ".livres" foi gravado
+    long modifiedSec;    // data de modificação da lista nesse momento
+    long modifiedNsec;
+    int head;            // primeiro registro livre ou LIST_END
+} LIVRES_HEADER;
+
+typedef struct {
+    int fd;                 // arquivo "<lista>.livres"
+    int head;               // primeiro registro livre ou LIST_END
+} LIVRES;
+
+/**
+ * @brief Abre a lista de registros livres de uma lista
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param listFd descritor de arquivo aberto da lista
+ */
+bool openFreeList(const std::string &arquivoDaLista, int listFd, LIVRES &freeList);
+
+/**
+ * @brief Retira um registro da lista de livres
+ * @param end final lógico da lista, ou -1 para o final do arquivo
+ * @return endereço do registro ou o final da lista se não houver registro livre
+ */
+int takeFreeRecord(int listFd, LIVRES &freeList, int end = -1);
+
+/**
+ * @brief Marca um registro como livre e o coloca no início da lista de livres
+ */
+bool putFreeRecord(int listFd, LIVRES &freeList, int address);
+
+/**
+ * @brief Grava o início da lista de livres e fecha o arquivo ".livres". Deve ser chamada depois da
+ * última escrita na lista, para que a data de modificação gravada seja a final.
+ * @param listFd descritor de arquivo aberto da lista
+ */
+void closeFreeList(LIVRES &freeList, int listFd);
+
+/**
+ * @brief Endereço onde o próximo registro deve ser escrito: um registro livre ou o final do arquivo.
+ * A lista de livres fica aberta até confirmaRegistro, chamada depois da escrita do registro.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param freeList recebe a lista de livres aberta
+ */
+int alocaRegistro(std::string arquivoDaLista, LIVRES &freeList);
+
+/**
+ * @brief Fecha a lista de livres aberta por alocaRegistro, depois que o registro alocado foi escrito,
+ * para que a data de modificação gravada seja a final
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param address registro devolvido por alocaRegistro
+ * @param linked false se o registro não foi ligado à lista: ele volta para a lista de livres
+ */
+void confirmaRegistro(std::string arquivoDaLista, LIVRES &freeList, int address, bool linked);
+
+/**
+ * @brief Remove da lista o primeiro registro com um nome e o coloca na lista de livres
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param nome nome a ser removido
+ * @return false se o nome não está na lista
+ */
+bool remove(std::string arquivoDaLista, std::string nome);
+
+#endif /* livres_h */
@@ -0,0 +1,113 @@
+/**
+ * Inserção em lote na lista encadeada em disco
+ */
+
+#include "lote.h"
+#include "lista.h"
+#include "livres.h"
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <set>
+#include <unistd.h>
+
+/**
+ * @brief Mesmo efeito de chamar adiciona para cada par, na ordem do vetor, mas com um único percurso
+ * da lista, uma única escrita sequencial dos novos registros ao final do arquivo (depois de ocupar
+ * os registros livres) e os ponteiros next alterados corrigidos em ordem de endereço. Um
+ * depoisDesteNome pode ser um nome inserido antes no mesmo lote; se o nome também já estiver na
+ * lista, vale o registro da lista.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param novos pares (novoNome, depoisDesteNome)
+ * @return false (sem alterar o arquivo) se algum depoisDesteNome não estiver na lista nem no lote
+ */
+bool adicionaVarios(std::string arquivoDaLista, const std::vector<std::pair<std::string, std::string>> &novos)
+{
+    int fd = open(arquivoDaLista.c_str(), O_RDWR);
+    if (fd < 0)
+        return false;
+
+    int base = endOfList(fd);
+    std::vector<char> list(base, 0);                              // The whole list in one read
+    ssize_t length = pread(fd, list.data(), base, 0);
+    if (length < HEAD_SIZE) {
+        close(fd);
+        return false;
+    }
+
+    std::set<std::string> anchors;
+    for (const auto &pair : novos)
+        anchors.insert(pair.second);
+
+    // One traversal resolves every anchor that is already in the list (first occurrence wins, as in adiciona)
+    std::map<std::string, int> addressOf;
+    std::map<int, int> nextOf;                                    // Current next of every record we may touch
+    int address;
+    memcpy(&address, list.data(), HEAD_SIZE);
+    for (int hops(0); !isListEnd(address) && address + RECORD_SIZE <= length && hops <= base / RECORD_SIZE; hops++) {
+        REGISTRO record;
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        std::string name(record.name, strnlen(record.name, NAME_SIZE));
+        if (anchors.count(name) && !addressOf.count(name)) {
+            addressOf[name] = address;
+            nextOf[address] = record.next;
+        }
+        address = record.next;
+    }
+
+    std::set<std::string> known;                                  // Every anchor must exist before anything is written
+    for (const auto &pair : novos) {
+        if (!addressOf.count(pair.second) && !known.count(pair.second)) {
+            close(fd);
+            return false;
+        }
+        known.insert(pair.first);
+    }
+
+    // Free records are reused first; the rest get consecutive slots at the end of the file
+    std::vector<int> addresses;
+    LIVRES freeList;
+    bool haveFreeList = openFreeList(arquivoDaLista, fd, freeList);
+    while (haveFreeList && addresses.size() < novos.size()) {
+        int address = takeFreeRecord(fd, freeList);
+        if (address >= base)
+            break;
+        addresses.push_back(address);
+    }
+    size_t reused = addresses.size();
+    for (int i(0); addresses.size() < novos.size(); i++)
+        addresses.push_back(base + i * RECORD_SIZE);
+
+    // Splice in memory, in request order
+    std::vector<REGISTRO> records;
+    for (size_t i(0); i < novos.size(); i++) {
+        int anchor = addressOf[novos[i].second];
+        records.push_back(makeRecord(novos[i].first, 0));
+        nextOf[addresses[i]] = nextOf[anchor];
+        nextOf[anchor] = addresses[i];
+        if (!addressOf.count(novos[i].first))
+            addressOf[novos[i].first] = addresses[i];
+    }
+    for (size_t i(0); i < records.size(); i++)                    // Final pointers, after every splice of the batch
+        records[i].next = nextOf[addresses[i]];
+
+    // New records first (reused slots, then one sequential write at the end), then the old pointers in offset order
+    bool ok(true);
+    for (size_t i(0); ok && i < reused; i++)
+        ok = writeRecord(fd, addresses[i], records[i]);
+    ssize_t size = (records.size() - reused) * RECORD_SIZE;
+    ok = ok && pwrite(fd, records.data() + reused, size, base) == size;
+    std::set<int> created(addresses.begin(), addresses.end());
+    for (auto it = nextOf.begin(); ok && it != nextOf.end() && it->first < base; ++it) {
+        if (created.count(it->first))
+            continue;
+        int old;
+        memcpy(&old, list.data() + it->first + REG_SIZE, sizeof(int));
+        if (old != it->second)
+            ok = writeNext(fd, it->first, it->second);
+    }
+    if (haveFreeList)
+        closeFreeList(freeList, fd);
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,23 @@
+/**
+ * Inserção em lote na lista encadeada em disco
+ */
+
+#ifndef lote_h
+#define lote_h
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Mesmo efeito de chamar adiciona para cada par, na ordem do vetor, mas com um único percurso
+ * da lista, uma única escrita sequencial dos novos registros ao final do arquivo (depois de ocupar
+ * os registros livres) e os ponteiros next alterados corrigidos em ordem de endereço. Um
+ * depoisDesteNome pode ser um nome inserido antes no mesmo lote; se o nome também já estiver na
+ * lista, vale o registro da lista.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param novos pares (novoNome, depoisDesteNome)
+ * @return false (sem alterar o arquivo) se algum depoisDesteNome não estiver na lista nem no lote
+ */
+bool adicionaVarios(std::string arquivoDaLista, const std::vector<std::pair<std::string, std::string>> &novos);
+
+#endif /* lote_h */
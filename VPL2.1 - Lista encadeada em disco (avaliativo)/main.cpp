@@ -1,9 +1,25 @@
 #include "gtest/gtest.h"
 #include "fs.h"
 #include "sha256.h"
+#include "lista.h"
+#include "indice.h"
+#include "lote.h"
+#include "livres.h"
+#include "compacta.h"
+#include "mapa.h"
+#include "ordenada.h"
+#include "concorrente.h"
+#include "busca.h"
+#include "gerador.h"
 
 #include <fstream>
 #include <stdio.h>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 void duplicate(std::string fsrc, std::string fdest)
 {
@@ -13,6 +29,21 @@ void duplicate(std::string fsrc, std::string fdest)
     dst << src.rdbuf();
 }
 
+std::vector<std::string> nomes(std::string arquivoDaLista)
+{
+    std::vector<std::string> result;
+    int fd = open(arquivoDaLista.c_str(), O_RDONLY);
+    int address;
+    REGISTRO record;
+    readHead(fd, address);
+    while (readRecord(fd, address, record) && result.size() < 1000000) {
+        result.push_back(std::string(record.name, strnlen(record.name, NAME_SIZE)));
+        address = record.next;
+    }
+    close(fd);
+    return result;
+}
+
 
 TEST(FsTest, case1){
     
@@ -23,6 +54,290 @@ TEST(FsTest, case1){
     ASSERT_EQ(printSha256("lista.bin.solucao"),std::string("0A:F1:8F:E8:A6:34:9B:73:68:B1:52:66:74:71:DA:56:B3:6E:F8:96:0A:C4:F8:75:E1:C0:F1:DE:F4:5B:91:5D"));
 
 }
+TEST(FsTest, indexedInsert){
+    duplicate("lista.bin", "lista-idx.bin.solucao");
+    unlink("lista-idx.bin.solucao.idx");
+    unlink("lista-idx.bin.solucao.livres");
+
+    ASSERT_TRUE(adicionaIndexado("lista-idx.bin.solucao", "Anderson", "Everton"));
+    ASSERT_FALSE(adicionaIndexado("lista-idx.bin.solucao", "Zeca", "Ninguem"));
+    std::vector<std::string> expected{"Jair", "Everton", "Anderson", "Chico", "Maria", "Heloisa", "Pedro", "Gustavo", "Laura", "Claudia"};
+    ASSERT_EQ(nomes("lista-idx.bin.solucao"), expected);
+
+    for (int i(0); i < 100; i++) {                                             // Grows the table several times
+        std::string anchor = i == 0 ? std::string("Claudia") : "n" + std::to_string(i - 1);
+        ASSERT_TRUE(adicionaIndexado("lista-idx.bin.solucao", "n" + std::to_string(i), anchor));
+        expected.push_back("n" + std::to_string(i));
+    }
+    ASSERT_EQ(nomes("lista-idx.bin.solucao"), expected);
+    ASSERT_EQ(procuraIndexado("lista-idx.bin.solucao", "Chico"), 60);
+
+    struct timespec old[2] = {{time(NULL) - 10, 0}, {time(NULL) - 10, 0}};      // Last write well in the past
+    ASSERT_EQ(utimensat(AT_FDCWD, "lista-idx.bin.solucao", old, 0), 0);
+    ASSERT_EQ(procuraIndexado("lista-idx.bin.solucao", "Chico"), 60);          // Stamp changed: rebuilt once
+    struct stat before, after;                                                 // A miss is answered by the index alone
+    ASSERT_EQ(stat("lista-idx.bin.solucao.idx", &before), 0);
+    ASSERT_EQ(procuraIndexado("lista-idx.bin.solucao", "Ninguem"), LIST_END);
+    ASSERT_EQ(stat("lista-idx.bin.solucao.idx", &after), 0);
+    ASSERT_EQ(after.st_mtim.tv_nsec, before.st_mtim.tv_nsec);
+    ASSERT_EQ(after.st_mtim.tv_sec, before.st_mtim.tv_sec);
+
+    adiciona("lista-idx.bin.solucao", "Bia", "Jair");                          // Changes the list behind the index
+    ASSERT_EQ(procuraIndexado("lista-idx.bin.solucao", "Bia"), 284 + 100 * RECORD_SIZE);
+
+    ASSERT_TRUE(adicionaIndexado("lista-idx.bin.solucao", "p", "Jair"));
+    struct stat stamped;
+    stat("lista-idx.bin.solucao", &stamped);
+    ASSERT_TRUE(remove("lista-idx.bin.solucao", "p"));
+    adiciona("lista-idx.bin.solucao", "q", "Jair");                            // Reuses p's record: same size
+    struct timespec sameTick[2] = {stamped.st_atim, stamped.st_mtim};           // As on a coarse-timestamp filesystem
+    ASSERT_EQ(utimensat(AT_FDCWD, "lista-idx.bin.solucao", sameTick, 0), 0);
+    ASSERT_NE(procuraIndexado("lista-idx.bin.solucao", "q"), LIST_END);
+}
+TEST(FsTest, batchInsert){
+    duplicate("lista.bin", "lista-lote.bin.solucao");
+    duplicate("lista.bin", "lista-seq.bin.solucao");
+
+    std::vector<std::pair<std::string, std::string>> novos{
+        {"Anderson", "Everton"}, {"Bia", "Everton"}, {"Caio", "Bia"}, {"Davi", "Claudia"}, {"Eva", "Jair"}};
+    ASSERT_TRUE(adicionaVarios("lista-lote.bin.solucao", novos));
+    for (const auto &pair : novos)                                             // Same result as one insert at a time
+        ASSERT_TRUE(adicionaIndexado("lista-seq.bin.solucao", pair.first, pair.second));
+    ASSERT_EQ(nomes("lista-lote.bin.solucao"), nomes("lista-seq.bin.solucao"));
+    std::vector<std::string> lista = nomes("lista-lote.bin.solucao");
+    ASSERT_EQ(std::vector<std::string>(lista.begin(), lista.begin() + 6), std::vector<std::string>({"Jair", "Eva", "Everton", "Bia", "Caio", "Anderson"}));
+
+    std::string before = printSha256("lista-lote.bin.solucao");
+    ASSERT_FALSE(adicionaVarios("lista-lote.bin.solucao", {{"Fabio", "Jair"}, {"Gil", "Ninguem"}}));
+    ASSERT_EQ(printSha256("lista-lote.bin.solucao"), before);                 // Nothing written on failure
+}
+TEST(FsTest, removeAndReuse){
+    duplicate("lista.bin", "lista-livres.bin.solucao");
+    unlink("lista-livres.bin.solucao.livres");
+    unlink("lista-livres.bin.solucao.idx");
+
+    ASSERT_TRUE(remove("lista-livres.bin.solucao", "Jair"));                   // First record: the head moves
+    ASSERT_TRUE(remove("lista-livres.bin.solucao", "Maria"));
+    ASSERT_FALSE(remove("lista-livres.bin.solucao", "Ninguem"));
+    ASSERT_EQ(nomes("lista-livres.bin.solucao"),
+              std::vector<std::string>({"Everton", "Chico", "Heloisa", "Pedro", "Gustavo", "Laura", "Claudia"}));
+
+    struct stat st;
+    stat("lista-livres.bin.solucao", &st);
+    off_t size = st.st_size;
+    for (int round(0); round < 50; round++) {                                  // Churn never grows the file
+        ASSERT_TRUE(adicionaIndexado("lista-livres.bin.solucao", "a" + std::to_string(round), "Chico"));
+        adiciona("lista-livres.bin.solucao", "b" + std::to_string(round), "Claudia");
+        ASSERT_TRUE(adicionaVarios("lista-livres.bin.solucao", {{"c" + std::to_string(round), "Everton"}}));
+        ASSERT_TRUE(remove("lista-livres.bin.solucao", "a" + std::to_string(round)));
+        ASSERT_TRUE(remove("lista-livres.bin.solucao", "b" + std::to_string(round)));
+        ASSERT_TRUE(remove("lista-livres.bin.solucao", "c" + std::to_string(round)));
+    }
+    stat("lista-livres.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, size);
+    ASSERT_EQ(nomes("lista-livres.bin.solucao").size(), 7u);
+
+    LIVRES_HEADER header;                                                      // Stamped after the last write
+    int fd = open("lista-livres.bin.solucao.livres", O_RDONLY);
+    ASSERT_EQ(pread(fd, &header, sizeof(header), 0), (ssize_t) sizeof(header));
+    close(fd);
+    ASSERT_EQ(header.size, st.st_size);
+    ASSERT_EQ(header.modifiedSec, st.st_mtim.tv_sec);
+    ASSERT_EQ(header.modifiedNsec, st.st_mtim.tv_nsec);
+
+    adiciona("lista-livres.bin.solucao", "d", "Ninguem");                      // Not linked: back on the free list
+    ASSERT_TRUE(adicionaIndexado("lista-livres.bin.solucao", "e", "Chico"));   // Jair's and Maria's records
+    ASSERT_TRUE(adicionaIndexado("lista-livres.bin.solucao", "f", "Chico"));
+    stat("lista-livres.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, size);
+
+    unlink("lista-livres.bin.solucao.livres");
+    mkdir("lista-livres.bin.solucao.livres", 0755);                            // Free list unavailable
+    ASSERT_TRUE(remove("lista-livres.bin.solucao", "e"));
+    rmdir("lista-livres.bin.solucao.livres");
+    ASSERT_TRUE(adicionaIndexado("lista-livres.bin.solucao", "g", "Chico"));   // The rebuild finds e's record
+    stat("lista-livres.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, size);
+}
+TEST(FsTest, compaction){
+    duplicate("lista.bin", "lista-compacta.bin.solucao");
+    ASSERT_TRUE(remove("lista-compacta.bin.solucao", "Maria"));
+    std::vector<std::string> before = nomes("lista-compacta.bin.solucao");
+    LISTA_CONCORRENTE concurrent;                                              // Leaves a .cauda at the old end
+    ASSERT_TRUE(abreConcorrente("lista-compacta.bin.solucao", concurrent));
+    fechaConcorrente(concurrent);
+
+    ASSERT_TRUE(compacta("lista-compacta.bin.solucao"));
+    ASSERT_EQ(nomes("lista-compacta.bin.solucao"), before);
+
+    struct stat st;
+    stat("lista-compacta.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, HEAD_SIZE + (off_t) before.size() * RECORD_SIZE);   // Free records are gone
+    int fd = open("lista-compacta.bin.solucao", O_RDONLY);
+    int address;
+    readHead(fd, address);
+    for (size_t i(0); i < before.size(); i++) {                                // Physical order is traversal order
+        ASSERT_EQ(address, HEAD_SIZE + (int) i * RECORD_SIZE);
+        REGISTRO record;
+        readRecord(fd, address, record);
+        address = record.next;
+    }
+    ASSERT_TRUE(isListEnd(address));
+    close(fd);
+
+    ASSERT_TRUE(adicionaIndexado("lista-compacta.bin.solucao", "Anderson", "Everton"));
+    ASSERT_EQ(nomes("lista-compacta.bin.solucao")[2], std::string("Anderson"));
+
+    ASSERT_TRUE(abreConcorrente("lista-compacta.bin.solucao", concurrent));    // Appends right after Anderson
+    ASSERT_TRUE(adicionaConcorrente(concurrent, "Bia", "Jair"));
+    fechaConcorrente(concurrent);
+    stat("lista-compacta.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, HEAD_SIZE + (off_t) (before.size() + 2) * RECORD_SIZE);
+}
+TEST(FsTest, mappedList){
+    duplicate("lista.bin", "lista-mapa.bin.solucao");
+    unlink("lista-mapa.bin.solucao.livres");
+    std::vector<std::string> expected = nomes("lista-mapa.bin.solucao");
+
+    LISTA_MAPEADA lista;
+    ASSERT_TRUE(abreMapeada("lista-mapa.bin.solucao", lista));
+    std::vector<std::string> walked;
+    for (REGISTRO &registro : lista)
+        walked.push_back(std::string(registro.name, strnlen(registro.name, NAME_SIZE)));
+    ASSERT_EQ(walked, expected);
+    ASSERT_EQ(procuraMapeada(lista, "Everton"), 256);
+
+    ASSERT_TRUE(adicionaMapeada(lista, "Anderson", "Everton"));               // Takes the free record at 4
+    ASSERT_EQ(procuraMapeada(lista, "Anderson"), 4);
+    expected.insert(expected.begin() + 2, "Anderson");
+    for (int i(0); i < 1000; i++) {                                            // Grows the mapping several times
+        ASSERT_TRUE(adicionaMapeada(lista, "m" + std::to_string(i), "Claudia"));
+        expected.insert(expected.end() - i, "m" + std::to_string(i));
+    }
+    ASSERT_FALSE(adicionaMapeada(lista, "x", "Ninguem"));
+    fechaMapeada(lista);
+
+    ASSERT_EQ(nomes("lista-mapa.bin.solucao"), expected);
+    struct stat st;
+    stat("lista-mapa.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, 284 + 1000 * RECORD_SIZE);                           // Truncated to the logical size
+
+    ASSERT_TRUE(remove("lista-mapa.bin.solucao", "m0"));
+    ASSERT_TRUE(abreMapeada("lista-mapa.bin.solucao", lista));
+    registroMapeado(lista, lista.freeList.head)->used = 1;                      // Reused behind the free list's back
+    ASSERT_TRUE(adicionaMapeada(lista, "y", "Jair"));                          // The rebuild stops at the logical size
+    ASSERT_TRUE(isListEnd(lista.freeList.head));
+    fechaMapeada(lista);
+}
+TEST(FsTest, sortedList){
+    ASSERT_TRUE(converteParaOrdenada("lista.bin", "lista-ordenada.bin.solucao"));
+    LISTA_ORDENADA lista;
+    ASSERT_TRUE(abreOrdenada("lista-ordenada.bin.solucao", lista));
+
+    std::vector<std::string> sorted = nomes("lista.bin");
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_EQ(intervaloOrdenada(lista, "", "zzzz"), sorted);
+    ASSERT_EQ(intervaloOrdenada(lista, "Claudia", "Heloisa"),
+              std::vector<std::string>({"Claudia", "Everton", "Gustavo", "Heloisa"}));
+    ASSERT_NE(buscaOrdenada(lista, "Pedro"), LIST_END);
+    ASSERT_EQ(buscaOrdenada(lista, "Pedra"), LIST_END);
+
+    for (int i(0); i < 500; i++) {                                             // Pseudo-random order
+        std::string nome = "n" + std::to_string((i * 7919) % 500);
+        ASSERT_TRUE(insereOrdenada(lista, nome));
+        sorted.push_back(nome);
+    }
+    ASSERT_FALSE(insereOrdenada(lista, "Pedro"));
+    fechaOrdenada(lista);
+
+    std::sort(sorted.begin(), sorted.end());
+    ASSERT_TRUE(abreOrdenada("lista-ordenada.bin.solucao", lista));
+    ASSERT_EQ(intervaloOrdenada(lista, "", "zzzz"), sorted);
+    for (const std::string &nome : sorted)
+        ASSERT_NE(buscaOrdenada(lista, nome), LIST_END);
+    ASSERT_EQ(intervaloOrdenada(lista, "n10", "n102"), std::vector<std::string>({"n10", "n100", "n101", "n102"}));
+    fechaOrdenada(lista);
+}
+TEST(FsTest, concurrentInsert){
+    duplicate("lista.bin", "lista-conc.bin.solucao");
+    unlink("lista-conc.bin.solucao.cauda");
+
+    std::vector<pid_t> writers;
+    for (int w(0); w < 4; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            LISTA_CONCORRENTE lista;
+            bool ok = abreConcorrente("lista-conc.bin.solucao", lista);
+            for (int i(0); ok && i < 200; i++)                                 // Everyone fights over the same anchors
+                ok = adicionaConcorrente(lista, "w" + std::to_string(w) + "-" + std::to_string(i), i % 2 ? "Jair" : "Claudia");
+            fechaConcorrente(lista);
+            _exit(ok ? 0 : 1);
+        }
+        writers.push_back(pid);
+    }
+    for (pid_t pid : writers) {
+        int status;
+        waitpid(pid, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    std::vector<std::string> lista = nomes("lista-conc.bin.solucao");
+    ASSERT_EQ(lista.size(), 9u + 800u);                                        // No insert was lost
+    std::sort(lista.begin(), lista.end());
+    ASSERT_TRUE(std::adjacent_find(lista.begin(), lista.end()) == lista.end());
+    struct stat st;
+    stat("lista-conc.bin.solucao", &st);
+    ASSERT_EQ(st.st_size, 284 + 800 * RECORD_SIZE);                            // Every reserved slot was used once
+}
+
+TEST(FsTest, vectorSearch){
+    ASSERT_EQ(procuraVetorizada("lista.bin", "Jair"), 32);
+    ASSERT_EQ(procuraVetorizada("lista.bin", "Claudia"), 144);
+    ASSERT_EQ(procuraVetorizada("lista.bin", "Bia"), LIST_END);
+
+    // Every implementation must agree, including records too close to the end for a full vector load
+    std::vector<char> list(HEAD_SIZE, 0);
+    for (int i(0); i < 103; i++) {
+        REGISTRO record = makeRecord(i % 10 == 3 ? "alvo" : i % 10 == 4 ? "alvo2" : "n" + std::to_string(i), LIST_END);
+        record.used = i % 20 != 13;                                            // A free record must never match
+        memset(record.name + strlen(record.name) + 1, 'x', NAME_SIZE - strlen(record.name) - 1); // Garbage after '\0', as in lista.bin
+        list.insert(list.end(), reinterpret_cast<char*>(&record), reinterpret_cast<char*>(&record) + RECORD_SIZE);
+    }
+    std::vector<int> expected;
+    for (int i(3); i < 103; i += 10)
+        if (i % 20 != 13)
+            expected.push_back(HEAD_SIZE + i * RECORD_SIZE);
+    for (IMPLEMENTACAO_BUSCA implementacao : {BUSCA_ESCALAR, BUSCA_SSE2, BUSCA_AVX2, BUSCA_AUTOMATICA}) {
+        ASSERT_EQ(procuraNomes(list.data(), list.size(), "alvo", implementacao), expected);
+        ASSERT_EQ(procuraNomes(list.data(), list.size(), "n102", implementacao), std::vector<int>({HEAD_SIZE + 102 * RECORD_SIZE}));
+        ASSERT_TRUE(procuraNomes(list.data(), list.size(), "alv", implementacao).empty());
+        ASSERT_TRUE(procuraNomes(list.data(), list.size(), std::string(21, 'a'), implementacao).empty());
+    }
+
+    int head(LIST_END);                                                        // Several matches: only linked ones count
+    memcpy(list.data(), &head, HEAD_SIZE);
+    ASSERT_EQ(primeiroComNome(list.data(), list.size(), "alvo"), LIST_END);
+    head = expected[1];
+    memcpy(list.data(), &head, HEAD_SIZE);
+    ASSERT_EQ(primeiroComNome(list.data(), list.size(), "alvo"), expected[1]);
+}
+
+TEST(FsTest, generatedList){
+    std::vector<std::string> expected;
+    for (int i(0); i < 1000; i++)
+        expected.push_back(nomeGerado(i));
+    for (bool embaralhada : {false, true}) {
+        ASSERT_TRUE(geraLista("lista-gerada.bin.solucao", 1000, embaralhada, 7));
+        ASSERT_EQ(nomes("lista-gerada.bin.solucao"), expected);
+        struct stat st;
+        stat("lista-gerada.bin.solucao", &st);
+        ASSERT_EQ(st.st_size, HEAD_SIZE + 1000 * RECORD_SIZE);
+    }
+    ASSERT_NE(procuraVetorizada("lista-gerada.bin.solucao", "n0"), HEAD_SIZE);   // Shuffled: the head is not in slot 0
+    adiciona("lista-gerada.bin.solucao", "novo", "n999");                        // The generated list works with the original code
+    expected.push_back("novo");
+    ASSERT_EQ(nomes("lista-gerada.bin.solucao"), expected);
+}
 
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
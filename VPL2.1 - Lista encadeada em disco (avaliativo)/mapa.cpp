@@ -0,0 +1,155 @@
+/**
+ * Lista encadeada em disco acessada por mmap
+ */
+
+#include "mapa.h"
+#include "busca.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Garante que o mapeamento cobre pelo menos needed bytes, dobrando a capacidade
+ */
+static bool reserve(LISTA_MAPEADA &lista, size_t needed)
+{
+    if (needed <= lista.capacity)
+        return true;
+    size_t capacity = lista.capacity;
+    while (capacity < needed)
+        capacity *= 2;                                            // Geometric growth: amortized O(1) appends
+    if (ftruncate(lista.fd, capacity) < 0)
+        return false;
+    void *base = mremap(lista.base, lista.capacity, capacity, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED)
+        return false;
+    lista.base = static_cast<char*>(base);
+    lista.capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Mapeia uma lista para leitura e escrita
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param lista lista mapeada
+ * @return true se a lista foi mapeada
+ */
+bool abreMapeada(std::string arquivoDaLista, LISTA_MAPEADA &lista)
+{
+    lista.arquivo = arquivoDaLista;
+    lista.base = NULL;
+    lista.freeList.fd = -1;
+    lista.fd = open(arquivoDaLista.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lista.fd < 0)
+        return false;
+
+    openFreeList(arquivoDaLista, lista.fd, lista.freeList);      // Before the file is grown past its logical size
+    lista.size = endOfList(lista.fd);
+    lista.capacity = MAP_MIN_CAPACITY;
+    while (lista.capacity < lista.size)
+        lista.capacity *= 2;
+    struct stat st;
+    bool empty = fstat(lista.fd, &st) < 0 || st.st_size < HEAD_SIZE;
+    void *base = ftruncate(lista.fd, lista.capacity) < 0 ? MAP_FAILED :
+                 mmap(NULL, lista.capacity, PROT_READ | PROT_WRITE, MAP_SHARED, lista.fd, 0);
+    if (base == MAP_FAILED) {
+        closeFreeList(lista.freeList, lista.fd);
+        close(lista.fd);
+        lista.fd = -1;
+        return false;
+    }
+    lista.base = static_cast<char*>(base);
+    if (empty) {                                                  // New list: just the header
+        int head = LIST_END;
+        memcpy(lista.base, &head, HEAD_SIZE);
+        lista.size = HEAD_SIZE;
+    }
+    return true;
+}
+
+/**
+ * @brief Trunca o arquivo para o tamanho lógico e desfaz o mapeamento
+ */
+void fechaMapeada(LISTA_MAPEADA &lista)
+{
+    if (lista.fd < 0)
+        return;
+    munmap(lista.base, lista.capacity);
+    ftruncate(lista.fd, lista.size);                              // Drop the unused tail of the last growth
+    closeFreeList(lista.freeList, lista.fd);
+    close(lista.fd);
+    lista.fd = -1;
+    lista.base = NULL;
+}
+
+/**
+ * @brief Registro em um endereço do mapeamento. O ponteiro deixa de valer depois de uma inserção,
+ * que pode mover o mapeamento.
+ * @return ponteiro para o registro ou NULL se o endereço está fora da lista
+ */
+REGISTRO *registroMapeado(const LISTA_MAPEADA &lista, int address)
+{
+    if (isListEnd(address) || static_cast<size_t>(address) + RECORD_SIZE > lista.size)
+        return NULL;
+    return reinterpret_cast<REGISTRO*>(lista.base + address);
+}
+
+ITERADOR &ITERADOR::operator++()
+{
+    int next = (**this).next;
+    address = registroMapeado(*lista, next) != NULL ? next : LIST_END;
+    return *this;
+}
+
+/**
+ * @brief Percurso da lista: for (REGISTRO &registro : lista)
+ */
+ITERADOR begin(const LISTA_MAPEADA &lista)
+{
+    int head;
+    memcpy(&head, lista.base, HEAD_SIZE);
+    return ITERADOR{&lista, registroMapeado(lista, head) != NULL ? head : LIST_END};
+}
+
+ITERADOR end(const LISTA_MAPEADA &lista)
+{
+    return ITERADOR{&lista, LIST_END};
+}
+
+/**
+ * @brief Endereço do primeiro registro com um nome
+ * @return endereço ou LIST_END se o nome não estiver na lista
+ */
+int procuraMapeada(const LISTA_MAPEADA &lista, const std::string &nome)
+{
+    return primeiroComNome(lista.base, lista.size, nome);        // Vector scan of the mapping, no pointer chasing
+}
+
+/**
+ * @brief Mesmo efeito de adiciona sobre uma lista mapeada
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista ou se o arquivo não pôde crescer
+ */
+bool adicionaMapeada(LISTA_MAPEADA &lista, const std::string &novoNome, const std::string &depoisDesteNome)
+{
+    int anchor = procuraMapeada(lista, depoisDesteNome);
+    if (anchor == LIST_END)
+        return false;
+
+    int address = lista.freeList.fd >= 0 ? takeFreeRecord(lista.fd, lista.freeList, lista.size) // Not the mapped capacity
+                                         : static_cast<int>(lista.size);
+    if (static_cast<size_t>(address) >= lista.size) {             // No free record: append
+        address = lista.size;
+        if (!reserve(lista, lista.size + RECORD_SIZE))
+            return false;
+        lista.size += RECORD_SIZE;
+    }
+
+    REGISTRO *anchorRecord = registroMapeado(lista, anchor);      // After reserve: the mapping may have moved
+    *registroMapeado(lista, address) = makeRecord(novoNome, anchorRecord->next);
+    anchorRecord->next = address;
+    return true;
+}
@@ -0,0 +1,75 @@
+/**
+ * Lista encadeada em disco acessada por mmap: os registros são lidos e alterados diretamente no
+ * mapeamento, sem uma chamada de sistema por campo. O arquivo cresce em potências de 2 e é
+ * truncado para o tamanho lógico ao fechar.
+ */
+
+#ifndef mapa_h
+#define mapa_h
+#include "lista.h"
+#include "livres.h"
+#include <cstddef>
+#include <string>
+
+#define MAP_MIN_CAPACITY 4096
+
+typedef struct {
+    std::string arquivo;    // nome do arquivo da lista
+    int fd;                 // arquivo da lista
+    char *base;             // início do mapeamento
+    size_t capacity;        // bytes mapeados (e tamanho físico do arquivo)
+    size_t size;            // bytes usados (tamanho lógico da lista)
+    LIVRES freeList;        // registros livres reaproveitados pelas inserções
+} LISTA_MAPEADA;
+
+typedef struct ITERADOR {
+    const LISTA_MAPEADA *lista;
+    int address;            // registro atual ou LIST_END
+
+    REGISTRO &operator*() const { return *reinterpret_cast<REGISTRO*>(lista->base + address); }
+    REGISTRO *operator->() const { return reinterpret_cast<REGISTRO*>(lista->base + address); }
+    bool operator!=(const ITERADOR &other) const { return address != other.address; }
+    ITERADOR &operator++();
+} ITERADOR;
+
+/**
+ * @brief Mapeia uma lista para leitura e escrita
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param lista lista mapeada
+ * @return true se a lista foi mapeada
+ */
+bool abreMapeada(std::string arquivoDaLista, LISTA_MAPEADA &lista);
+
+/**
+ * @brief Trunca o arquivo para o tamanho lógico e desfaz o mapeamento
+ */
+void fechaMapeada(LISTA_MAPEADA &lista);
+
+/**
+ * @brief Registro em um endereço do mapeamento. O ponteiro deixa de valer depois de uma inserção,
+ * que pode mover o mapeamento.
+ * @return ponteiro para o registro ou NULL se o endereço está fora da lista
+ */
+REGISTRO *registroMapeado(const LISTA_MAPEADA &lista, int address);
+
+/**
+ * @brief Percurso da lista: for (REGISTRO &registro : lista)
+ */
+ITERADOR begin(const LISTA_MAPEADA &lista);
+ITERADOR end(const LISTA_MAPEADA &lista);
+
+/**
+ * @brief Endereço do primeiro registro com um nome
+ * @return endereço ou LIST_END se o nome não estiver na lista
+ */
+int procuraMapeada(const LISTA_MAPEADA &lista, const std::string &nome);
+
+/**
+ * @brief Mesmo efeito de adiciona sobre uma lista mapeada
+ * @param novoNome nome a ser adicionado apos depoisDesteNome
+ * @param depoisDesteNome um nome presente na lista
+ * @return false se depoisDesteNome não está na lista ou se o arquivo não pôde crescer
+ */
+bool adicionaMapeada(LISTA_MAPEADA &lista, const std::string &novoNome, const std::string &depoisDesteNome);
+
+#endif /* mapa_h */
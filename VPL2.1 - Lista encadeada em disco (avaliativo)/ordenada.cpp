@@ -0,0 +1,254 @@
+/**
+ * Variante ordenada (skip list) da lista encadeada em disco
+ */
+
+#include "ordenada.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @brief Endereço do k-ésimo registro
+ */
+static int recordAddress(int k)
+{
+    return sizeof(SKIP_HEADER) + k * static_cast<int>(sizeof(SKIP_REGISTRO));
+}
+
+/**
+ * @brief Nome completado com zeros, para comparar com memcmp
+ */
+static void paddedName(const std::string &nome, char name[NAME_SIZE])
+{
+    memset(name, 0, NAME_SIZE);
+    memcpy(name, nome.data(), std::min<size_t>(nome.size(), NAME_SIZE));
+}
+
+/**
+ * @brief Altura da torre de um nome: derivada do hash do nome, sem estado e com distribuição geométrica
+ */
+static int towerHeight(const char name[NAME_SIZE])
+{
+    unsigned int hash = 2166136261u;                              // FNV-1a
+    for (int i(0); i < NAME_SIZE; i++) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 16777619u;
+    }
+    int height(1);
+    while (height < SKIP_MAX_LEVEL && hash % SKIP_BRANCHING == 0) {
+        hash /= SKIP_BRANCHING;
+        height++;
+    }
+    return height;
+}
+
+static bool readSkip(int fd, int address, SKIP_REGISTRO &record)
+{
+    return pread(fd, &record, sizeof(SKIP_REGISTRO), address) == sizeof(SKIP_REGISTRO);
+}
+
+/**
+ * @brief Desce a skip list até o último registro com nome menor que name em cada nível
+ * @param update recebe, por nível, o endereço desse registro (LIST_END = cabeçalho)
+ * @return endereço do primeiro registro com nome >= name, ou LIST_END
+ */
+static int descend(LISTA_ORDENADA &lista, const char name[NAME_SIZE], int update[SKIP_MAX_LEVEL])
+{
+    int current(LIST_END);                                        // LIST_END stands for the header
+    SKIP_REGISTRO record;
+    SKIP_REGISTRO candidate;
+    int candidateAddress(LIST_END);
+    for (int level = lista.header.level - 1; level >= 0; level--) {
+        for (;;) {
+            int next = current == LIST_END ? lista.header.head[level] : record.next[level];
+            if (isListEnd(next))
+                break;
+            if (next != candidateAddress && !readSkip(lista.fd, next, candidate)) // One read per hop
+                break;
+            candidateAddress = next;
+            if (memcmp(candidate.name, name, NAME_SIZE) >= 0)
+                break;
+            current = next;
+            record = candidate;
+        }
+        if (update != NULL)
+            update[level] = current;
+    }
+    int first = current == LIST_END ? (lista.header.level > 0 ? lista.header.head[0] : LIST_END) : record.next[0];
+    return first;
+}
+
+/**
+ * @brief Abre (ou cria, se não existir) uma lista ordenada
+ * @param arquivoOrdenado nome do arquivo da lista ordenada
+ */
+bool abreOrdenada(std::string arquivoOrdenado, LISTA_ORDENADA &lista)
+{
+    lista.fd = open(arquivoOrdenado.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lista.fd < 0)
+        return false;
+    if (pread(lista.fd, &lista.header, sizeof(SKIP_HEADER), 0) == sizeof(SKIP_HEADER))
+        return lista.header.magic == SKIP_MAGIC;
+
+    lista.header.magic = SKIP_MAGIC;                              // Empty file: new list
+    lista.header.level = 0;
+    lista.header.count = 0;
+    std::fill(lista.header.head, lista.header.head + SKIP_MAX_LEVEL, LIST_END);
+    return pwrite(lista.fd, &lista.header, sizeof(SKIP_HEADER), 0) == sizeof(SKIP_HEADER);
+}
+
+/**
+ * @brief Grava o cabeçalho e fecha a lista ordenada
+ */
+void fechaOrdenada(LISTA_ORDENADA &lista)
+{
+    if (lista.fd < 0)
+        return;
+    pwrite(lista.fd, &lista.header, sizeof(SKIP_HEADER), 0);
+    close(lista.fd);
+    lista.fd = -1;
+}
+
+/**
+ * @brief Insere um nome na sua posição
+ * @return false se o nome já está na lista
+ */
+bool insereOrdenada(LISTA_ORDENADA &lista, const std::string &nome)
+{
+    SKIP_REGISTRO record;
+    paddedName(nome, record.name);
+    int update[SKIP_MAX_LEVEL];
+    std::fill(update, update + SKIP_MAX_LEVEL, LIST_END);
+    int found = descend(lista, record.name, update);
+    SKIP_REGISTRO existing;
+    if (!isListEnd(found) && readSkip(lista.fd, found, existing) && memcmp(existing.name, record.name, NAME_SIZE) == 0)
+        return false;
+
+    record.height = towerHeight(record.name);
+    std::fill(record.next, record.next + SKIP_MAX_LEVEL, LIST_END);
+    for (int level(0); level < record.height; level++) {         // Levels above the old top start at the header
+        int previous = level < lista.header.level ? update[level] : LIST_END;
+        if (previous == LIST_END)
+            record.next[level] = lista.header.head[level];
+        else if (readSkip(lista.fd, previous, existing))
+            record.next[level] = existing.next[level];
+    }
+
+    // New record first, then the predecessors' pointers bottom-up
+    int address = recordAddress(lista.header.count);
+    if (pwrite(lista.fd, &record, sizeof(SKIP_REGISTRO), address) != sizeof(SKIP_REGISTRO))
+        return false;
+    for (int level(0); level < record.height; level++) {
+        int previous = level < lista.header.level ? update[level] : LIST_END;
+        if (previous == LIST_END)
+            lista.header.head[level] = address;
+        else
+            pwrite(lista.fd, &address, sizeof(int), previous + offsetof(SKIP_REGISTRO, next) + level * sizeof(int));
+    }
+    lista.header.level = std::max(lista.header.level, record.height);
+    lista.header.count++;
+    return pwrite(lista.fd, &lista.header, sizeof(SKIP_HEADER), 0) == sizeof(SKIP_HEADER);
+}
+
+/**
+ * @brief Endereço do registro com um nome
+ * @return endereço ou LIST_END se o nome não estiver na lista
+ */
+int buscaOrdenada(LISTA_ORDENADA &lista, const std::string &nome)
+{
+    char name[NAME_SIZE];
+    paddedName(nome, name);
+    int found = descend(lista, name, NULL);
+    SKIP_REGISTRO record;
+    if (!isListEnd(found) && readSkip(lista.fd, found, record) && memcmp(record.name, name, NAME_SIZE) == 0)
+        return found;
+    return LIST_END;
+}
+
+/**
+ * @brief Nomes em [de, ate], em ordem
+ */
+std::vector<std::string> intervaloOrdenada(LISTA_ORDENADA &lista, const std::string &de, const std::string &ate)
+{
+    char from[NAME_SIZE];
+    char to[NAME_SIZE];
+    paddedName(de, from);
+    paddedName(ate, to);
+
+    std::vector<std::string> names;
+    SKIP_REGISTRO record;
+    for (int address = descend(lista, from, NULL); !isListEnd(address) && readSkip(lista.fd, address, record);
+         address = record.next[0]) {                              // Level 0 from the first name >= de
+        if (memcmp(record.name, to, NAME_SIZE) > 0)
+            break;
+        names.push_back(std::string(record.name, strnlen(record.name, NAME_SIZE)));
+    }
+    return names;
+}
+
+/**
+ * @brief Cria uma lista ordenada com os nomes de uma lista encadeada (nomes repetidos aparecem uma vez).
+ * Os nomes são ordenados em memória e o arquivo é escrito de uma vez, com torres determinísticas.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param arquivoOrdenado nome do arquivo da lista ordenada a ser criada
+ */
+bool converteParaOrdenada(std::string arquivoDaLista, std::string arquivoOrdenado)
+{
+    int fd = open(arquivoDaLista.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    int end = endOfList(fd);
+    std::vector<char> list(end, 0);                               // The whole linked list in one read
+    ssize_t length = pread(fd, list.data(), end, 0);
+    close(fd);
+    if (length < HEAD_SIZE)
+        return false;
+
+    std::vector<std::string> names;
+    int address;
+    memcpy(&address, list.data(), HEAD_SIZE);
+    for (int hops(0); !isListEnd(address) && address + RECORD_SIZE <= length && hops <= end / RECORD_SIZE; hops++) {
+        REGISTRO record;
+        memcpy(&record, list.data() + address, RECORD_SIZE);
+        char name[NAME_SIZE];
+        paddedName(std::string(record.name, strnlen(record.name, NAME_SIZE)), name);
+        names.push_back(std::string(name, NAME_SIZE));            // Padded, so std::string order is memcmp order
+        address = record.next;
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    // Perfectly balanced towers: record k reaches level j + 1 when (k + 1) is a multiple of 4^j
+    SKIP_HEADER header{SKIP_MAGIC, 0, static_cast<int>(names.size()), {0}};
+    std::fill(header.head, header.head + SKIP_MAX_LEVEL, LIST_END);
+    std::vector<SKIP_REGISTRO> records(names.size());
+    int last[SKIP_MAX_LEVEL];
+    std::fill(last, last + SKIP_MAX_LEVEL, LIST_END);
+    for (size_t k(0); k < names.size(); k++) {
+        SKIP_REGISTRO &record = records[k];
+        memcpy(record.name, names[k].data(), NAME_SIZE);
+        std::fill(record.next, record.next + SKIP_MAX_LEVEL, LIST_END);
+        record.height = 1;
+        for (size_t step(SKIP_BRANCHING); record.height < SKIP_MAX_LEVEL && (k + 1) % step == 0; step *= SKIP_BRANCHING)
+            record.height++;
+        for (int level(0); level < record.height; level++) {
+            if (last[level] == LIST_END)
+                header.head[level] = recordAddress(k);
+            else
+                records[last[level]].next[level] = recordAddress(k);
+            last[level] = k;
+        }
+        header.level = std::max(header.level, record.height);
+    }
+
+    int out = open(arquivoOrdenado.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0)
+        return false;
+    ssize_t size = records.size() * sizeof(SKIP_REGISTRO);
+    bool ok = pwrite(out, &header, sizeof(SKIP_HEADER), 0) == sizeof(SKIP_HEADER) &&
+              pwrite(out, records.data(), size, sizeof(SKIP_HEADER)) == size;
+    close(out);
+    return ok;
+}
@@ -0,0 +1,73 @@
+/**
+ * Variante ordenada da lista encadeada em disco: uma skip list em que cada registro guarda, além do
+ * nome de 20 bytes, uma torre de ponteiros. Inserção ordenada, busca e percurso de intervalo fazem
+ * O(log n) leituras. Os nomes são comparados byte a byte, completados com zeros.
+ *
+ * Arquivo: SKIP_HEADER seguido de registros SKIP_REGISTRO de tamanho fixo.
+ */
+
+#ifndef ordenada_h
+#define ordenada_h
+#include "lista.h"
+#include <string>
+#include <vector>
+
+#define SKIP_MAGIC 0x50494B53     // "SKIP"
+#define SKIP_MAX_LEVEL 12         // 4^12 names before the towers stop growing
+#define SKIP_BRANCHING 4          // A record reaches level k + 1 with probability 1/4
+
+typedef struct {
+    int magic;
+    int level;                    // níveis em uso
+    int count;                    // quantidade de nomes
+    int head[SKIP_MAX_LEVEL];     // primeiro registro de cada nível
+} SKIP_HEADER;
+
+typedef struct {
+    char name[NAME_SIZE];         // nome completado com zeros
+    int height;                   // quantidade de ponteiros usados em next
+    int next[SKIP_MAX_LEVEL];     // próximo registro de cada nível
+} SKIP_REGISTRO;
+
+typedef struct {
+    int fd;
+    SKIP_HEADER header;
+} LISTA_ORDENADA;
+
+/**
+ * @brief Abre (ou cria, se não existir) uma lista ordenada
+ * @param arquivoOrdenado nome do arquivo da lista ordenada
+ */
+bool abreOrdenada(std::string arquivoOrdenado, LISTA_ORDENADA &lista);
+
+/**
+ * @brief Grava o cabeçalho e fecha a lista ordenada
+ */
+void fechaOrdenada(LISTA_ORDENADA &lista);
+
+/**
+ * @brief Insere um nome na sua posição
+ * @return false se o nome já está na lista
+ */
+bool insereOrdenada(LISTA_ORDENADA &lista, const std::string &nome);
+
+/**
+ * @brief Endereço do registro com um nome
+ * @return endereço ou LIST_END se o nome não estiver na lista
+ */
+int buscaOrdenada(LISTA_ORDENADA &lista, const std::string &nome);
+
+/**
+ * @brief Nomes em [de, ate], em ordem
+ */
+std::vector<std::string> intervaloOrdenada(LISTA_ORDENADA &lista, const std::string &de, const std::string &ate);
+
+/**
+ * @brief Cria uma lista ordenada com os nomes de uma lista encadeada (nomes repetidos aparecem uma vez).
+ * Os nomes são ordenados em memória e o arquivo é escrito de uma vez, com torres determinísticas.
+ * @param arquivoDaLista nome do arquivo em disco que contem a lista encadeada
+ * @param arquivoOrdenado nome do arquivo da lista ordenada a ser criada
+ */
+bool converteParaOrdenada(std::string arquivoDaLista, std::string arquivoOrdenado);
+
+#endif /* ordenada_h */